@@ -0,0 +1,96 @@
+#include "Arena.h"
+
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+BlockArena::BlockArena(size_t blockBytes, bool hugePages) : blockBytes(blockBytes), hugePages(hugePages) {
+#ifdef _WIN32
+	if (hugePages) {
+		//large pages must be allocated in multiples of the large page size
+		size_t large = GetLargePageMinimum();
+		if (large > 0) {
+			this->blockBytes = (blockBytes + large - 1) / large * large;
+		}
+	}
+#else
+	if (hugePages) {
+		const size_t large = 2 << 20;
+		this->blockBytes = (blockBytes + large - 1) / large * large;
+	}
+#endif
+}
+
+BlockArena::~BlockArena() {
+	for (auto block : blocks) {
+#ifdef _WIN32
+		VirtualFree(block, 0, MEM_RELEASE);
+#else
+		munmap(block, blockBytes);
+#endif
+	}
+}
+
+void* BlockArena::allocateFromOs() {
+	void* block = nullptr;
+#ifdef _WIN32
+	if (hugePages) {
+		block = VirtualAlloc(nullptr, blockBytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	}
+	if (block) {
+		gotHugePages = true;
+	} else {
+		block = VirtualAlloc(nullptr, blockBytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	}
+#else
+	if (hugePages) {
+		block = mmap(nullptr, blockBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (block == MAP_FAILED) {
+			block = nullptr;
+		} else {
+			gotHugePages = true;
+		}
+	}
+	if (!block) {
+		block = mmap(nullptr, blockBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (block == MAP_FAILED) {
+			block = nullptr;
+		}
+	}
+#endif
+	if (!block) {
+		throw std::bad_alloc();
+	}
+	//touch every page now, so the first write during recording does not take a page fault
+	for (size_t i = 0; i < blockBytes; i += 4096) {
+		static_cast<volatile char*>(block)[i] = 0;
+	}
+	blocks.push_back(block);
+	return block;
+}
+
+void* BlockArena::allocate() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!freeBlocks.empty()) {
+		void* block = freeBlocks.back();
+		freeBlocks.pop_back();
+		return block;
+	}
+	return allocateFromOs();
+}
+
+void BlockArena::release(void* block) {
+	std::lock_guard<std::mutex> lock(mutex);
+	freeBlocks.push_back(block);
+}
+
+void BlockArena::preallocate(size_t count) {
+	std::lock_guard<std::mutex> lock(mutex);
+	while (freeBlocks.size() < count) {
+		freeBlocks.push_back(allocateFromOs());
+	}
+}
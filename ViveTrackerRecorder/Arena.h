@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/*
+Hands out fixed-size memory blocks. Blocks are never moved or copied once handed out, and released
+blocks are kept for reuse instead of being given back to the OS.
+Optionally backed by huge pages (needs SeLockMemoryPrivilege on Windows), falls back to normal pages.
+*/
+class BlockArena {
+private:
+	size_t blockBytes;
+	bool hugePages;
+	bool gotHugePages = false;
+
+	std::mutex mutex;
+	std::vector<void*> blocks;
+	std::vector<void*> freeBlocks;
+
+	void* allocateFromOs();
+public:
+	BlockArena(size_t blockBytes = 1 << 20, bool hugePages = false);
+	~BlockArena();
+	BlockArena(const BlockArena&) = delete;
+	BlockArena& operator=(const BlockArena&) = delete;
+
+	void* allocate();
+	void release(void* block);
+	// Makes sure at least count blocks can be handed out without asking the OS
+	void preallocate(size_t count);
+
+	size_t blockSize() const {
+		return blockBytes;
+	}
+	size_t blockCount() const {
+		return blocks.size();
+	}
+	size_t bytes() const {
+		return blocks.size() * blockBytes;
+	}
+	bool usingHugePages() const {
+		return gotHugePages;
+	}
+};
+
+/*
+Append-only array that grows one arena block at a time. Unlike std::vector it never reallocates,
+so push_back has no copy spikes and pointers into it stay valid.
+Elements are contiguous within a chunk, use chunkCount/chunk/chunkLength to stream over them.
+*/
+template <typename T>
+class ChunkedArray {
+	static_assert((sizeof(T) & (sizeof(T) - 1)) == 0, "element size must be a power of two");
+private:
+	BlockArena* arena;
+	std::vector<T*> chunks;
+	size_t count = 0;
+	size_t shift;
+	size_t mask;
+public:
+	explicit ChunkedArray(BlockArena* arena) : arena(arena) {
+		size_t perChunk = arena->blockSize() / sizeof(T);
+		shift = 0;
+		while (((size_t)1 << (shift + 1)) <= perChunk) shift++;
+		mask = ((size_t)1 << shift) - 1;
+	}
+	~ChunkedArray() {
+		release();
+	}
+	ChunkedArray(const ChunkedArray&) = delete;
+	ChunkedArray& operator=(const ChunkedArray&) = delete;
+	ChunkedArray(ChunkedArray&& other) : arena(other.arena), chunks(std::move(other.chunks)), count(other.count), shift(other.shift), mask(other.mask) {
+		other.chunks.clear();
+		other.count = 0;
+	}
+
+	void push_back(const T& value) {
+		size_t c = count >> shift;
+		if (c == chunks.size()) {
+			chunks.push_back(static_cast<T*>(arena->allocate()));
+		}
+		chunks[c][count & mask] = value;
+		count++;
+	}
+
+	T& operator[](size_t i) {
+		return chunks[i >> shift][i & mask];
+	}
+	const T& operator[](size_t i) const {
+		return chunks[i >> shift][i & mask];
+	}
+	const T& back() const {
+		return (*this)[count - 1];
+	}
+
+	size_t size() const {
+		return count;
+	}
+	bool empty() const {
+		return count == 0;
+	}
+	size_t capacity() const {
+		return chunks.size() << shift;
+	}
+
+	size_t chunkCount() const {
+		return (count + mask) >> shift;
+	}
+	const T* chunk(size_t c) const {
+		return chunks[c];
+	}
+	size_t chunkLength(size_t c) const {
+		size_t start = c << shift;
+		return count - start < mask + 1 ? count - start : mask + 1;
+	}
+
+	// Takes all blocks needed for n elements now, so pushing up to n never asks the arena
+	void reserve(size_t n) {
+		size_t needed = (n + mask) >> shift;
+		while (chunks.size() < needed) {
+			chunks.push_back(static_cast<T*>(arena->allocate()));
+		}
+	}
+	// Keeps the blocks for reuse by this array
+	void clear() {
+		count = 0;
+	}
+	// Gives all blocks back to the arena
+	void release() {
+		for (auto c : chunks) {
+			arena->release(c);
+		}
+		chunks.clear();
+		count = 0;
+	}
+};
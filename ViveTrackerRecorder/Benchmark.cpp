@@ -0,0 +1,730 @@
+#include "Benchmark.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include "Capture.h"
+#include "CaptureStats.h"
+#include "Daemon.h"
+#include "Export.h"
+#include "MockVR.h"
+#include "Rotation.h"
+#include "Scheduler.h"
+#include "SpscRing.h"
+#include "TakeFile.h"
+#include "VR.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/*
+A tracker moving smoothly at 250 Hz, with about 0.05 mm of sensor noise on top
+*/
+static void fillSyntheticTrack(DeviceTrack& track, size_t samples, int devId) {
+	uint32_t noise = 12345 + devId;
+	for (size_t i = 0; i < samples; i++) {
+		noise = noise * 1664525u + 1013904223u;
+		double jitter = ((noise >> 8) / (double)(1 << 24) - 0.5) * 0.0001;
+		double t = i * 0.004;
+		double angle = t * (0.5 + devId * 0.05);
+		vr::HmdVector3_t pos = { { (float)(std::cos(angle) * 0.5 + jitter), (float)(1.5 + std::sin(t) * 0.1), (float)(std::sin(angle) * 0.5 - jitter) } };
+		vr::HmdQuaternion_t rot;
+		rot.w = std::cos(angle / 2);
+		rot.x = 0;
+		rot.y = std::sin(angle / 2);
+		rot.z = 0;
+		track.push((int64_t)i * 4000000, pos, rot);
+	}
+}
+
+struct BenchResult {
+	double ticksPerSecond;
+	double samplesPerSecond;
+	double callsPerTick;
+};
+
+/*
+Runs one capture mode for a fixed wall time and counts the ticks that fit into it
+*/
+static BenchResult benchCaptureMode(int deviceCount, double callCostUs, bool batched) {
+	MockVRSystem mock(deviceCount, (long long)(callCostUs * 1000));
+	VR vr;
+	vr.attach(&mock);
+
+	std::vector<int> deviceList;
+	SampleStore samples;
+	for (int i = 0; i < deviceCount; i++) {
+		deviceList.push_back(i);
+		samples[i].reserve(1 << 16);
+	}
+
+	const auto duration = std::chrono::milliseconds(300);
+	long long ticks = 0;
+	long long sampleCount = 0;
+	auto start = Clock::now();
+	auto end = start + duration;
+	while (Clock::now() < end) {
+		int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+		if (batched) {
+			sampleCount += trackDevices(vr, deviceList, time, samples);
+		} else {
+			for (int devId : deviceList) {
+				sampleCount += trackDevice(vr, devId, time, samples[devId]) ? 1 : 0;
+			}
+		}
+		ticks++;
+		//keep memory flat, we only care about the speed of reading
+		if (samples[0].size() > (1 << 16) - 1) {
+			samples.clear();
+		}
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	vr.stop();
+
+	return { ticks / seconds, sampleCount / seconds, ticks ? (double)mock.callCount() / ticks : 0 };
+}
+
+void runCaptureBenchmark(double callCostUs) {
+	std::cout << "Capture benchmark, mock runtime with " << callCostUs << " us per call\n\n";
+	std::cout << std::setw(8) << "devices"
+		<< std::setw(16) << "per-dev tick/s" << std::setw(16) << "per-dev smp/s" << std::setw(14) << "calls/tick"
+		<< std::setw(16) << "batch tick/s" << std::setw(16) << "batch smp/s" << std::setw(14) << "calls/tick" << "\n";
+	std::cout << std::fixed << std::setprecision(0);
+	for (int devices = 1; devices <= (int)vr::k_unMaxTrackedDeviceCount; devices *= 2) {
+		auto perDevice = benchCaptureMode(devices, callCostUs, false);
+		auto batched = benchCaptureMode(devices, callCostUs, true);
+		std::cout << std::setw(8) << devices
+			<< std::setw(16) << perDevice.ticksPerSecond << std::setw(16) << perDevice.samplesPerSecond << std::setw(14) << perDevice.callsPerTick
+			<< std::setw(16) << batched.ticksPerSecond << std::setw(16) << batched.samplesPerSecond << std::setw(14) << batched.callsPerTick << "\n";
+	}
+}
+
+struct GapResult {
+	double maxTickUs;
+	double totalMs;
+};
+
+/*
+Pushes one sample per device per tick and keeps the slowest tick
+*/
+template <typename Push>
+static GapResult measureGaps(int devices, size_t samplesPerDevice, Push push) {
+	double maxTick = 0;
+	auto start = Clock::now();
+	vr::HmdVector3_t pos = { { 0.1f, 1.5f, 0.3f } };
+	vr::HmdQuaternion_t rot = { 1, 0, 0, 0 };
+	for (size_t i = 0; i < samplesPerDevice; i++) {
+		auto tickStart = Clock::now();
+		for (int devId = 0; devId < devices; devId++) {
+			pos.v[0] = (float)i;
+			push(devId, KeyFrame((int64_t)i * 1000000, pos, rot));
+		}
+		maxTick = std::max(maxTick, std::chrono::duration<double, std::micro>(Clock::now() - tickStart).count());
+	}
+	return { maxTick, std::chrono::duration<double, std::milli>(Clock::now() - start).count() };
+}
+
+void runStorageBenchmark(int devices, size_t samplesPerDevice) {
+	std::cout << "\nStorage benchmark, " << devices << " devices x " << samplesPerDevice << " samples\n\n";
+	std::cout << std::setw(24) << "storage" << std::setw(16) << "max tick us" << std::setw(16) << "total ms" << "\n";
+	std::cout << std::fixed << std::setprecision(1);
+	{
+		std::vector<std::vector<KeyFrame>> frames(devices);
+		auto result = measureGaps(devices, samplesPerDevice, [&](int devId, const KeyFrame& frame) {
+			frames[devId].push_back(frame);
+		});
+		std::cout << std::setw(24) << "vector<KeyFrame>" << std::setw(16) << result.maxTickUs << std::setw(16) << result.totalMs << "\n";
+	}
+	{
+		SampleStore samples;
+		auto result = measureGaps(devices, samplesPerDevice, [&](int devId, const KeyFrame& frame) {
+			samples[devId].push(frame);
+		});
+		std::cout << std::setw(24) << "SampleStore" << std::setw(16) << result.maxTickUs << std::setw(16) << result.totalMs << "\n";
+	}
+	{
+		SampleStore samples;
+		std::vector<int> deviceList;
+		for (int devId = 0; devId < devices; devId++) {
+			deviceList.push_back(devId);
+		}
+		samples.reserve(deviceList, samplesPerDevice);
+		auto result = measureGaps(devices, samplesPerDevice, [&](int devId, const KeyFrame& frame) {
+			samples[devId].push(frame);
+		});
+		std::cout << std::setw(24) << "SampleStore preallocated" << std::setw(16) << result.maxTickUs << std::setw(16) << result.totalMs << "\n";
+	}
+}
+
+void runTakeFileBenchmark(int devices, size_t samplesPerDevice) {
+	std::cout << "\nTake file benchmark, " << devices << " devices x " << samplesPerDevice << " samples\n\n";
+	SampleStore samples;
+	std::vector<RecordedDevice> recorded;
+	for (int devId = 0; devId < devices; devId++) {
+		fillSyntheticTrack(samples[devId], samplesPerDevice, devId);
+		recorded.push_back({ (uint32_t)devId, "Synthetic" });
+	}
+	double keyFrameBytes = (double)samples.totalSamples() * sizeof(KeyFrame);
+
+	std::stringstream stream;
+	auto start = Clock::now();
+	TakeWriter writer(stream, recorded);
+	for (auto& dev : recorded) {
+		writer.writeTrack(dev.id, samples[dev.id]);
+	}
+	writer.close();
+	double encodeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	SampleStore decoded;
+	std::vector<RecordedDevice> decodedDevices;
+	start = Clock::now();
+	readTake(stream, decoded, decodedDevices);
+	double decodeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "KeyFrame bytes:   " << keyFrameBytes / (1 << 20) << " MB (" << sizeof(KeyFrame) << " bytes/sample)\n";
+	std::cout << "Take file bytes:  " << writer.bytesWritten() / (double)(1 << 20) << " MB (" << std::setprecision(2) << writer.bytesWritten() / (double)samples.totalSamples() << " bytes/sample)\n";
+	std::cout << "Ratio:            " << keyFrameBytes / writer.bytesWritten() << "x\n";
+	std::cout << std::setprecision(0);
+	std::cout << "Encode:           " << samples.totalSamples() / encodeSeconds << " samples/s\n";
+	std::cout << "Decode:           " << samples.totalSamples() / decodeSeconds << " samples/s\n";
+}
+
+
+/*
+Exports the take into a scratch file and returns the seconds it took
+*/
+static double timeExport(const std::string& filename, const SampleStore& samples, const std::vector<RecordedDevice>& recorded, const ExportOptions& options, double& megabytes) {
+	auto start = Clock::now();
+	saveTake(filename, samples, recorded, options);
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	megabytes = file.tellg() / (double)(1 << 20);
+	file.close();
+	std::remove(filename.c_str());
+	return seconds;
+}
+
+void runFbxBenchmark(int devices, size_t samplesPerDevice) {
+	std::cout << "\nFBX export benchmark, " << devices << " devices x " << samplesPerDevice << " samples\n\n";
+	SampleStore samples;
+	std::vector<RecordedDevice> recorded;
+	for (int devId = 0; devId < devices; devId++) {
+		fillSyntheticTrack(samples[devId], samplesPerDevice, devId);
+		recorded.push_back({ (uint32_t)devId, "Synthetic" });
+	}
+	double keys = samples.totalSamples() * 6.0;
+
+	struct Variant {
+		const char* name;
+		bool native;
+		bool compress;
+	};
+	std::vector<Variant> variants;
+#ifndef NO_FBXSDK
+	variants.push_back({ "FBX SDK", false, false });
+#endif
+	variants.push_back({ "FbxBinaryWriter", true, false });
+#ifdef FBX_ZLIB
+	variants.push_back({ "FbxBinaryWriter zlib", true, true });
+#endif
+
+	std::cout << std::left << std::setw(22) << "Writer" << std::right << std::setw(12) << "seconds" << std::setw(12) << "MB" << std::setw(16) << "keys/s" << "\n";
+	for (auto& variant : variants) {
+		ExportOptions options;
+		options.nativeFbx = variant.native;
+		options.fbx.compress = variant.compress;
+		double megabytes = 0;
+		double seconds = timeExport("benchmark.fbx", samples, recorded, options, megabytes);
+		std::cout << std::left << std::setw(22) << variant.name << std::right << std::fixed << std::setprecision(2) << std::setw(12) << seconds
+			<< std::setprecision(1) << std::setw(12) << megabytes << std::setprecision(0) << std::setw(16) << keys / seconds << "\n";
+	}
+}
+
+/*
+Builds the curves of the take on a pool of the given size and returns the seconds it took
+*/
+static double timeCurves(const SampleStore& samples, const std::vector<RecordedDevice>& recorded, const ExportOptions& options, size_t threads) {
+	ThreadPool pool(threads);
+	std::vector<ReduceReport> reports;
+	auto start = Clock::now();
+	auto curves = prepareCurves(samples, recorded, options, pool, reports);
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void runExportScalingBenchmark(size_t samplesPerDevice) {
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	std::cout << "\nExport scaling benchmark, " << samplesPerDevice << " samples per device, 1 vs " << cores << " threads\n";
+	//both columns build the curves the same way, only the pool size differs
+	std::cout << "curves: prepareCurves alone, as every export runs it";
+#ifndef NO_FBXSDK
+	std::cout << "; sdk: whole FBX SDK export";
+#endif
+	std::cout << "\n\n" << std::setw(8) << "devices" << std::setw(12) << "curves 1" << std::setw(12) << "curves N" << std::setw(10) << "speedup";
+#ifndef NO_FBXSDK
+	std::cout << std::setw(12) << "sdk 1" << std::setw(12) << "sdk N" << std::setw(10) << "speedup";
+#endif
+	std::cout << "\n";
+	for (int devices : { 1, 2, 4, 8, 12, 16, 20 }) {
+		SampleStore samples;
+		std::vector<RecordedDevice> recorded;
+		for (int devId = 0; devId < devices; devId++) {
+			fillSyntheticTrack(samples[devId], samplesPerDevice, devId);
+			recorded.push_back({ (uint32_t)devId, "Synthetic" });
+		}
+
+		ExportOptions options;
+		double serial = timeCurves(samples, recorded, options, 1);
+		double parallel = timeCurves(samples, recorded, options, cores);
+		std::cout << std::fixed << std::setprecision(3) << std::setw(8) << devices << std::setw(12) << serial << std::setw(12) << parallel << std::setw(9) << serial / parallel << "x";
+#ifndef NO_FBXSDK
+		//the sdk export always goes through prepareCurves, so here too only the pool size differs
+		double megabytes = 0;
+		options.nativeFbx = false;
+		options.threads = 1;
+		serial = timeExport("benchmark.fbx", samples, recorded, options, megabytes);
+		options.threads = cores;
+		parallel = timeExport("benchmark.fbx", samples, recorded, options, megabytes);
+		std::cout << std::setw(12) << serial << std::setw(12) << parallel << std::setw(9) << serial / parallel << "x";
+#endif
+		std::cout << "\n";
+	}
+}
+
+/*
+Angle in degrees between the rotations of two quaternions, which need not be normalized
+*/
+static double rotationAngle(double ax, double ay, double az, double aw, double bx, double by, double bz, double bw) {
+	double dot = ax * bx + ay * by + az * bz + aw * bw;
+	double norm = std::sqrt((ax * ax + ay * ay + az * az + aw * aw) * (bx * bx + by * by + bz * bz + bw * bw));
+	return 2 * std::acos(std::min(1.0, std::abs(dot) / norm)) * 57.29577951308232;
+}
+
+/*
+Inverse of toEulerAngles (roll x, pitch y, yaw z in degrees)
+*/
+static vr::HmdQuaternion_t fromEuler(double roll, double pitch, double yaw) {
+	const double toRadians = 0.008726646259971648; //half of pi / 180
+	double cr = std::cos(roll * toRadians), sr = std::sin(roll * toRadians);
+	double cp = std::cos(pitch * toRadians), sp = std::sin(pitch * toRadians);
+	double cy = std::cos(yaw * toRadians), sy = std::sin(yaw * toRadians);
+	vr::HmdQuaternion_t q;
+	q.w = cr * cp * cy + sr * sp * sy;
+	q.x = sr * cp * cy - cr * sp * sy;
+	q.y = cr * sp * cy + sr * cp * sy;
+	q.z = cr * cp * sy - sr * sp * cy;
+	return q;
+}
+
+/*
+toEulerAngles as it was before the batch kernels, pitch from asin, kept to measure what the atan2 pitch changed
+*/
+static vr::HmdVector3_t toEulerAnglesAsin(vr::HmdQuaternion_t q) {
+	vr::HmdVector3_t angles;
+	angles.v[0] = (float)std::atan2(2 * (q.w * q.x + q.y * q.z), 1 - 2 * (q.x * q.x + q.y * q.y));
+	double sinp = 2 * (q.w * q.y - q.z * q.x);
+	if (std::abs(sinp) >= 1)
+		angles.v[1] = (float)std::copysign(1.5707963267948966, sinp);
+	else
+		angles.v[1] = (float)std::asin(sinp);
+	angles.v[2] = (float)std::atan2(2 * (q.w * q.z + q.x * q.y), 1 - 2 * (q.y * q.y + q.z * q.z));
+	for (int i = 0; i <= 2; i++) {
+		angles.v[i] *= (float)57.29577951308232;
+	}
+	return angles;
+}
+
+bool runRotationBenchmark(size_t count) {
+	std::cout << "\nRotation conversion benchmark, " << count << " samples, this CPU supports " << simdName(detectSimd()) << "\n\n";
+
+	//random unit quaternions, then the rotations that are hard for Euler angles: pitch at and near +-90 degrees, half turns
+	std::vector<vr::HmdMatrix34_t> matrices(count);
+	uint32_t seed = 12345;
+	auto random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / (double)(1 << 24) * 2 - 1;
+	};
+	for (size_t i = 0; i < count; i++) {
+		double x, y, z, w, norm;
+		if (i % 16 == 0) {
+			double pitch = (i % 32 == 0 ? 90 : -90) - random() * (i % 64 < 32 ? 0 : 0.01);
+			auto q = fromEuler(random() * 180, pitch, random() * 180);
+			x = q.x, y = q.y, z = q.z, w = q.w;
+		} else if (i % 16 == 1) {
+			x = random(), y = random(), z = random(), w = 0;
+		} else {
+			x = random(), y = random(), z = random(), w = random();
+		}
+		norm = std::sqrt(x * x + y * y + z * z + w * w);
+		x /= norm, y /= norm, z /= norm, w /= norm;
+		auto& m = matrices[i].m;
+		m[0][0] = (float)(1 - 2 * (y * y + z * z)); m[0][1] = (float)(2 * (x * y - z * w)); m[0][2] = (float)(2 * (x * z + y * w)); m[0][3] = 0;
+		m[1][0] = (float)(2 * (x * y + z * w)); m[1][1] = (float)(1 - 2 * (x * x + z * z)); m[1][2] = (float)(2 * (y * z - x * w)); m[1][3] = 0;
+		m[2][0] = (float)(2 * (x * z - y * w)); m[2][1] = (float)(2 * (y * z + x * w)); m[2][2] = (float)(1 - 2 * (x * x + y * y)); m[2][3] = 0;
+	}
+
+	//the reference, and the float quaternions every level converts to Euler so only that step is compared
+	std::vector<vr::HmdQuaternion_t> reference(count);
+	std::vector<float> qx(count), qy(count), qz(count), qw(count);
+	for (size_t i = 0; i < count; i++) {
+		reference[i] = getRotation(matrices[i]);
+		qx[i] = (float)reference[i].x;
+		qy[i] = (float)reference[i].y;
+		qz[i] = (float)reference[i].z;
+		qw[i] = (float)reference[i].w;
+	}
+
+	std::vector<float> x(count), y(count), z(count), w(count);
+	std::cout << std::left << std::setw(8) << "level" << std::right << std::setw(14) << "quat M/s" << std::setw(14) << "euler M/s"
+		<< std::setw(14) << "quat err deg" << std::setw(15) << "euler err deg" << "\n";
+	bool passed = true;
+	for (int level = SimdScalar; level <= detectSimd(); level++) {
+		auto start = Clock::now();
+		matricesToQuaternions(matrices.data(), count, sizeof(vr::HmdMatrix34_t), x.data(), y.data(), z.data(), w.data(), (SimdLevel)level);
+		double quatSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+		double quatError = 0;
+		for (size_t i = 0; i < count; i++) {
+			auto& r = reference[i];
+			quatError = std::max(quatError, rotationAngle(x[i], y[i], z[i], w[i], r.x, r.y, r.z, r.w));
+		}
+
+		start = Clock::now();
+		quaternionsToEuler(qx.data(), qy.data(), qz.data(), qw.data(), count, x.data(), y.data(), z.data(), (SimdLevel)level);
+		double eulerSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+		double eulerError = 0;
+		for (size_t i = 0; i < count; i++) {
+			//checked against the rotation of the float quaternion itself, which toEulerAngles is not exact about
+			//near gimbal lock either, asin of an unnormalized quaternion loses up to 0.01 degrees there
+			double sinr = 2 * ((double)qw[i] * qx[i] + (double)qy[i] * qz[i]);
+			double cosr = 1 - 2 * ((double)qx[i] * qx[i] + (double)qy[i] * qy[i]);
+			double sinp = 2 * ((double)qw[i] * qy[i] - (double)qz[i] * qx[i]);
+			double pitch = std::atan2(sinp, std::sqrt(sinr * sinr + cosr * cosr)) * 57.29577951308232;
+			if (std::abs(pitch) > 89.9) {
+				//at gimbal lock roll and yaw come from atan2 of rounding noise, only pitch means something
+				eulerError = std::max(eulerError, std::abs(y[i] - pitch));
+				continue;
+			}
+			auto q = fromEuler(x[i], y[i], z[i]);
+			eulerError = std::max(eulerError, rotationAngle(q.x, q.y, q.z, q.w, qx[i], qy[i], qz[i], qw[i]));
+		}
+
+		bool ok = quatError <= quaternionToleranceDegrees && eulerError <= eulerToleranceDegrees;
+		passed = passed && ok;
+		std::cout << std::left << std::setw(8) << simdName((SimdLevel)level) << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(14) << count / quatSeconds / 1e6 << std::setw(14) << count / eulerSeconds / 1e6
+			<< std::scientific << std::setprecision(2) << std::setw(14) << quatError << std::setw(15) << eulerError
+			<< (ok ? "" : "  FAILED") << std::defaultfloat << "\n";
+	}
+
+	//the atan2 pitch against the asin one on the same double quaternions: away from gimbal lock they must agree,
+	//within 0.1 degrees of it only pitch is compared and the difference is what asin lost
+	double formulaError = 0, lockError = 0;
+	for (size_t i = 0; i < count; i++) {
+		auto now = toEulerAngles(reference[i]);
+		auto before = toEulerAnglesAsin(reference[i]);
+		if (std::abs(now.v[1]) > 89.9) {
+			lockError = std::max(lockError, (double)std::abs(now.v[1] - before.v[1]));
+			continue;
+		}
+		auto a = fromEuler(now.v[0], now.v[1], now.v[2]);
+		auto b = fromEuler(before.v[0], before.v[1], before.v[2]);
+		formulaError = std::max(formulaError, rotationAngle(a.x, a.y, a.z, a.w, b.x, b.y, b.z, b.w));
+	}
+	bool formulaOk = formulaError <= eulerToleranceDegrees;
+	passed = passed && formulaOk;
+	std::cout << std::scientific << std::setprecision(2) << "toEulerAngles atan2 vs asin pitch: " << formulaError << " degrees"
+		<< (formulaOk ? "" : "  FAILED") << ", " << lockError << " degrees of pitch near gimbal lock" << std::defaultfloat << "\n";
+	std::cout << "Tolerances " << quaternionToleranceDegrees << " and " << eulerToleranceDegrees << " degrees: " << (passed ? "passed" : "FAILED") << "\n";
+	return passed;
+}
+
+void runInstrumentationBenchmark(size_t samples) {
+	std::cout << "\nCapture instrumentation benchmark, " << samples << " samples\n\n";
+	RateScheduler scheduler(0);
+	scheduler.start();
+	volatile int64_t sink = 0;
+
+	//capture thread: the tick used to read the clock once for the sample time, now that comes from the scheduler's
+	//wake-up and the one read ends the pose read instead, so only the record is new
+	Histogram poseReads;
+	auto start = Clock::now();
+	for (size_t i = 0; i < samples; i++) {
+		sink = scheduler.elapsed();
+	}
+	double plainTick = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / samples;
+	start = Clock::now();
+	int64_t last = 0;
+	for (size_t i = 0; i < samples; i++) {
+		int64_t now = scheduler.elapsed();
+		poseReads.record(now - last);
+		last = now;
+	}
+	double timedTick = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / samples;
+
+	//consumer thread: every stored sample records its distance to the previous sample of its device
+	const int devices = 16;
+	std::vector<int64_t> times(samples);
+	uint32_t noise = 1;
+	for (size_t i = 0; i < samples; i++) {
+		noise = noise * 1664525u + 1013904223u;
+		//1 kHz with up to 50 us of jitter and now and then a late tick
+		times[i] = (int64_t)(i / devices) * 1000000 + (noise >> 16) % 50000 + ((noise >> 8) % 997 == 0 ? 3000000 : 0);
+	}
+	std::vector<Histogram> intervals(devices);
+	int64_t lastTimes[devices] = {};
+	start = Clock::now();
+	for (size_t i = 0; i < samples; i++) {
+		int devId = (int)(i % devices);
+		lastTimes[devId] = times[i];
+	}
+	double plainStore = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / samples;
+	start = Clock::now();
+	for (size_t i = 0; i < samples; i++) {
+		int devId = (int)(i % devices);
+		intervals[devId].record(times[i] - lastTimes[devId]);
+		lastTimes[devId] = times[i];
+	}
+	double timedStore = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / samples;
+	sink = lastTimes[0];
+	//reading the volatile back is a side effect too, and keeps compilers from calling it unused
+	(void)sink;
+
+	//worst case is one device per tick, the pose read is timed once per tick however many devices it has
+	double perSample = (timedTick - plainTick) + (timedStore - plainStore);
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "Pose read timing: " << timedTick - plainTick << " ns per tick on top of its clock read (" << plainTick << " ns)\n";
+	std::cout << "Interval histogram: " << timedStore - plainStore << " ns per sample\n";
+	std::cout << "Per sample with one device per tick: " << perSample << " ns, budget 50 ns: " << (perSample < 50 ? "passed" : "FAILED") << "\n";
+
+	//the histogram percentiles against the exact ones of the same values
+	std::vector<int64_t> exact;
+	Histogram all;
+	for (size_t i = devices; i < samples; i++) {
+		exact.push_back(times[i] - times[i - devices]);
+		all.record(exact.back());
+	}
+	std::sort(exact.begin(), exact.end());
+	double worstError = 0;
+	for (double percent : { 50.0, 90.0, 99.0, 99.9 }) {
+		auto rank = (size_t)std::ceil(exact.size() * percent / 100) - 1;
+		double error = std::abs((double)all.percentile(percent) - exact[rank]) / exact[rank];
+		worstError = std::max(worstError, error);
+	}
+	std::cout << "Percentile error against sorting: " << worstError * 100 << " %, max " << all.highest() / 1e6 << " ms\n" << std::defaultfloat;
+}
+
+struct LoadResult {
+	int devices;
+	double rate;
+	long long ticks;
+	long long missed;
+	size_t samples;
+	double seconds;
+	// pose read to stored samples, per tick
+	double latencyUs[5];
+	double storeBytes;
+	double exportSeconds;
+	double fileBytes;
+};
+
+static const double loadPercentiles[5] = { 50, 90, 99, 99.9, 100 };
+
+/*
+One take on the bench thread: every tick reads the poses into the ring and drains it the way the recorder's
+consumer does, so the measured time is everything a sample goes through before it is stored
+*/
+static LoadResult runLoad(int devices, double rate, const LoadBenchmarkOptions& options) {
+	MockOptions mockOptions;
+	mockOptions.deviceCount = devices;
+	mockOptions.callCostNs = (long long)(options.callCostUs * 1000);
+	mockOptions.rate = rate;
+	MockVRSystem mock(mockOptions);
+	VR vr;
+	vr.attach(&mock);
+
+	std::vector<int> deviceList;
+	std::vector<RecordedDevice> recorded;
+	for (int devId = 0; devId < devices; devId++) {
+		deviceList.push_back(devId);
+		recorded.push_back({ (uint32_t)devId, "Synthetic" });
+	}
+	SampleStore samples;
+	samples.reserve(deviceList, (size_t)(options.seconds * rate) + 1);
+
+	const size_t batchSize = 1024;
+	SpscRing<RawSample> ring(1 << 12);
+	std::vector<RawSample> batch(batchSize);
+	std::vector<float> qx(batchSize), qy(batchSize), qz(batchSize), qw(batchSize);
+	std::atomic<long long> invalidCounts[vr::k_unMaxTrackedDeviceCount];
+	for (auto& count : invalidCounts) {
+		count.store(0);
+	}
+	SimdLevel simd = detectSimd();
+	std::vector<float> latencies;
+	latencies.reserve((size_t)(options.seconds * rate) + 1);
+
+	RateScheduler scheduler(rate);
+	std::atomic<bool> stop(false);
+	auto start = Clock::now();
+	auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+	scheduler.start();
+	while (scheduler.wait(stop)) {
+		auto tickStart = Clock::now();
+		if (tickStart >= end) {
+			break;
+		}
+		int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(tickStart - start).count();
+		samplePoses(vr, deviceList, time, ring, invalidCounts);
+		size_t count = 0;
+		while (count < batchSize && ring.pop(batch[count])) {
+			count++;
+		}
+		matricesToQuaternions(&batch[0].matrix, count, sizeof(RawSample), qx.data(), qy.data(), qz.data(), qw.data(), simd);
+		for (size_t i = 0; i < count; i++) {
+			vr::HmdQuaternion_t rotation;
+			rotation.x = qx[i];
+			rotation.y = qy[i];
+			rotation.z = qz[i];
+			rotation.w = qw[i];
+			samples[batch[i].devId].push(batch[i].time, getPosition(batch[i].matrix), rotation);
+		}
+		latencies.push_back(std::chrono::duration<float, std::micro>(Clock::now() - tickStart).count());
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	vr.stop();
+
+	LoadResult result = {};
+	result.devices = devices;
+	result.rate = rate;
+	result.ticks = scheduler.tickCount();
+	result.missed = scheduler.missedDeadlines();
+	result.samples = samples.totalSamples();
+	result.seconds = seconds;
+	std::sort(latencies.begin(), latencies.end());
+	for (int i = 0; i < 5; i++) {
+		size_t index = latencies.empty() ? 0 : std::min(latencies.size() - 1, (size_t)(loadPercentiles[i] / 100 * latencies.size()));
+		result.latencyUs[i] = latencies.empty() ? 0 : latencies[index];
+	}
+	result.storeBytes = result.samples ? samples.bytes() / (double)result.samples : 0;
+
+	ExportOptions exportOptions;
+	exportOptions.nativeFbx = true;
+	double megabytes = 0;
+	result.exportSeconds = timeExport("benchmark.fbx", samples, recorded, exportOptions, megabytes);
+	result.fileBytes = result.samples ? megabytes * (1 << 20) / result.samples : 0;
+	return result;
+}
+
+void runLoadBenchmark(const LoadBenchmarkOptions& options) {
+	std::cout << "\nLoad benchmark, " << options.seconds << " s per take, mock runtime with " << options.callCostUs << " us per call, "
+		<< simdName(detectSimd()) << " rotations\n\n";
+	std::cout << std::setw(8) << "devices" << std::setw(8) << "rate" << std::setw(12) << "samples/s" << std::setw(8) << "missed"
+		<< std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(10) << "p99.9 us" << std::setw(10) << "max us"
+		<< std::setw(12) << "mem B/smp" << std::setw(12) << "file B/smp" << std::setw(12) << "export s" << "\n";
+
+	std::ofstream csv;
+	if (!options.csvFile.empty()) {
+		csv.open(options.csvFile);
+		csv << "devices,rate,seconds,ticks,missed,samples,samples_per_s,latency_p50_us,latency_p90_us,latency_p99_us,latency_p999_us,latency_max_us,"
+			<< "memory_bytes_per_sample,file_bytes_per_sample,export_s\n";
+	}
+	for (double rate : options.rates) {
+		for (int devices : options.deviceCounts) {
+			if (devices < 1 || devices > (int)vr::k_unMaxTrackedDeviceCount) {
+				continue;
+			}
+			auto r = runLoad(devices, rate, options);
+			double samplesPerSecond = r.samples / r.seconds;
+			std::cout << std::fixed << std::setprecision(0) << std::setw(8) << r.devices << std::setw(8) << r.rate << std::setw(12) << samplesPerSecond
+				<< std::setw(8) << r.missed << std::setprecision(1) << std::setw(10) << r.latencyUs[0] << std::setw(10) << r.latencyUs[2]
+				<< std::setw(10) << r.latencyUs[3] << std::setw(10) << r.latencyUs[4] << std::setw(12) << r.storeBytes << std::setw(12) << r.fileBytes
+				<< std::setprecision(3) << std::setw(12) << r.exportSeconds << "\n";
+			if (csv.is_open()) {
+				csv << r.devices << "," << r.rate << "," << r.seconds << "," << r.ticks << "," << r.missed << "," << r.samples << "," << samplesPerSecond;
+				for (double latency : r.latencyUs) {
+					csv << "," << latency;
+				}
+				csv << "," << r.storeBytes << "," << r.fileBytes << "," << r.exportSeconds << "\n";
+			}
+		}
+	}
+	if (csv.is_open()) {
+		std::cout << "Results written to " << options.csvFile << "\n";
+	}
+}
+
+bool runDaemonCheck() {
+	std::cout << "\nDaemon check against a mock runtime\n\n";
+	MockVRSystem mock(4);
+	VR vr;
+	vr.attach(&mock);
+	DaemonOptions options;
+	options.filename = "daemoncheck.vtr";
+	options.deviceList = { 0, 1, 2, 3 };
+	options.recorder.rate = 250;
+	std::vector<RecordedDevice> recorded;
+	for (int devId : options.deviceList) {
+		recorded.push_back({ (uint32_t)devId, "Mock " + std::to_string(devId) });
+	}
+
+	bool passed = true;
+	//runs a command and checks that its reply starts as expected
+	auto expect = [&](RecorderDaemon& daemon, const std::string& command, const std::string& reply) {
+		auto answer = daemon.handle(command);
+		bool ok = answer.compare(0, reply.size(), reply) == 0;
+		std::cout << std::left << std::setw(14) << command << answer << (ok ? "" : "  FAILED, expected " + reply) << "\n";
+		passed = passed && ok;
+	};
+	std::string file = takeFileName(options.filename, 1);
+	{
+		RecorderDaemon daemon(vr, options, recorded);
+		expect(daemon, "status", "ok idle after take 0");
+		expect(daemon, "marker early", "error");
+		expect(daemon, "stop", "error");
+		expect(daemon, "start", "ok take 1 " + file);
+		expect(daemon, "start", "error");
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		expect(daemon, "marker clap", "ok marker 1");
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		expect(daemon, "status", "ok recording take 1");
+		expect(daemon, "stop", "ok take 1");
+		expect(daemon, "status", "ok idle after take 1");
+		expect(daemon, "bogus", "error");
+		expect(daemon, "quit", "ok");
+		daemon.finish();
+	}
+
+	//the take file has every device, the markers file the marker, and the journal is gone
+	SampleStore samples;
+	std::vector<RecordedDevice> devices;
+	size_t count = 0;
+	try {
+		count = readTake(file, samples, devices);
+	} catch (std::exception& e) {
+		std::cout << e.what() << "\n";
+	}
+	bool allDevices = devices.size() == options.deviceList.size();
+	for (auto& device : devices) {
+		allDevices = allDevices && samples[device.id].size() > 50;
+	}
+	std::ifstream markers(file + ".markers.txt");
+	std::string line;
+	bool marked = std::getline(markers, line) && line.find("\tclap") != std::string::npos;
+	markers.close();
+	bool journalRemoved = !std::ifstream(file + ".journal");
+	std::cout << count << " samples of " << devices.size() << " devices, marker " << (marked ? "written" : "missing")
+		<< ", journal " << (journalRemoved ? "removed" : "left behind") << "\n";
+	passed = passed && allDevices && marked && journalRemoved;
+	std::remove(file.c_str());
+	std::remove((file + ".markers.txt").c_str());
+	std::remove((file + ".journal").c_str());
+	std::cout << "Daemon check: " << (passed ? "passed" : "FAILED") << "\n";
+	return passed;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+Runs the capture path against MockVRSystem and prints how the sample rate scales with the number of devices.
+callCostUs emulates the cost of one IPC round-trip to vrserver.
+*/
+void runCaptureBenchmark(double callCostUs);
+
+/*
+Stores a synthetic take of devices x samplesPerDevice and prints the longest time a single tick spent
+storing, for plain growing vectors against the arena-backed SampleStore.
+*/
+void runStorageBenchmark(int devices, size_t samplesPerDevice);
+
+/*
+Encodes and decodes a synthetic take as .vtr and prints size and speed against in-memory KeyFrames
+*/
+void runTakeFileBenchmark(int devices, size_t samplesPerDevice);
+
+/*
+Exports a synthetic take with the FBX SDK and with FbxBinaryWriter and prints time and file size of each
+*/
+void runFbxBenchmark(int devices, size_t samplesPerDevice);
+
+/*
+Builds the curves of synthetic takes of 1 to 20 devices with one thread and with all cores and prints how that
+scales, and the same for the whole FBX SDK export when it is built in
+*/
+void runExportScalingBenchmark(size_t samplesPerDevice);
+
+/*
+Converts count random rotations (plus the gimbal lock cases) with every SIMD level the CPU supports,
+prints the throughput and checks the results against the double precision per-sample functions.
+Also reports how far toEulerAngles is from its former asin pitch. Returns false if a check fails.
+*/
+bool runRotationBenchmark(size_t count);
+
+/*
+Times what the capture loop's instrumentation adds: the pose read timing per tick and the interval histogram per
+stored sample, against the same loops without it, and checks the histogram percentiles against sorting
+*/
+void runInstrumentationBenchmark(size_t samples);
+
+struct LoadBenchmarkOptions {
+public:
+	std::vector<int> deviceCounts = { 1, 2, 4, 8, 16, 30, 32, 64 };
+	std::vector<double> rates = { 250, 500, 1000, 2000 };
+	double seconds = 2;
+	double callCostUs = 20;
+	// one line per run, for comparing versions; empty writes only the table
+	std::string csvFile;
+};
+
+/*
+Drives the whole recording path with synthetic devices for every device count and rate: pose read, ring, rotation
+conversion and storage on every tick, then the FBX export of the take. Prints samples per second, percentiles of the
+time from pose read to stored samples per tick, bytes per sample in memory and in the file, and the export time.
+*/
+void runLoadBenchmark(const LoadBenchmarkOptions& options);
+
+/*
+Drives a RecorderDaemon through a mock runtime with start, marker, status and stop commands, prints every reply and
+checks the replies, the take file and the markers file. Returns false if any check failed.
+*/
+bool runDaemonCheck();
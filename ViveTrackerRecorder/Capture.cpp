@@ -0,0 +1,116 @@
+#include "Capture.h"
+
+#include <algorithm>
+
+bool trackDevice(VR& vr, int devId, int64_t time, DeviceTrack& track) {
+	vr::VRControllerState_t state;
+	vr::TrackedDevicePose_t pose;
+	// read device class
+	vr::ETrackedDeviceClass trackedDeviceClass = vr.getSystem()->GetTrackedDeviceClass(devId);
+	// read all generic trackers and controllers
+	if ((trackedDeviceClass == vr::ETrackedDeviceClass::TrackedDeviceClass_GenericTracker) || (trackedDeviceClass == vr::ETrackedDeviceClass::TrackedDeviceClass_Controller) || (trackedDeviceClass == vr::ETrackedDeviceClass::TrackedDeviceClass_TrackingReference)) {
+		if (!vr.getSystem()->GetControllerStateWithPose(vr::TrackingUniverseStanding, devId, &state, sizeof(state), &pose)) {
+			return false;
+		}
+	// for the HMD, functions are different
+	} else if (trackedDeviceClass == vr::ETrackedDeviceClass::TrackedDeviceClass_HMD) {
+		vr.getSystem()->GetDeviceToAbsoluteTrackingPose(vr::TrackingUniverseStanding, 0, &pose, 1);
+	} else {
+		return false;
+	}
+	if (!pose.bPoseIsValid) {
+		return false;
+	}
+	track.push(time, getPosition(pose.mDeviceToAbsoluteTracking), getRotation(pose.mDeviceToAbsoluteTracking));
+	return true;
+}
+
+/*
+The runtime fills the pose array from index 0, so only ask for as many as the highest recorded id needs
+*/
+static uint32_t readRecordedPoses(VR& vr, const std::vector<int>& deviceList, vr::TrackedDevicePose_t* poses) {
+	if (deviceList.empty()) {
+		return 0;
+	}
+	int maxId = *std::max_element(deviceList.begin(), deviceList.end());
+	uint32_t count = std::min<uint32_t>(maxId + 1, vr::k_unMaxTrackedDeviceCount);
+	vr.readPoses(poses, count);
+	return count;
+}
+
+int trackDevices(VR& vr, const std::vector<int>& deviceList, int64_t time, SampleStore& samples) {
+	vr::TrackedDevicePose_t poses[vr::k_unMaxTrackedDeviceCount];
+	uint32_t count = readRecordedPoses(vr, deviceList, poses);
+
+	int valid = 0;
+	for (int devId : deviceList) {
+		if (devId < 0 || devId >= (int)count) {
+			continue;
+		}
+		auto& pose = poses[devId];
+		if (pose.bPoseIsValid) {
+			samples[devId].push(time, getPosition(pose.mDeviceToAbsoluteTracking), getRotation(pose.mDeviceToAbsoluteTracking));
+			valid++;
+		}
+	}
+	return valid;
+}
+
+int samplePoses(VR& vr, const std::vector<int>& deviceList, int64_t time, SpscRing<RawSample>& ring, std::atomic<long long>* invalidCounts) {
+	vr::TrackedDevicePose_t poses[vr::k_unMaxTrackedDeviceCount];
+	uint32_t count = readRecordedPoses(vr, deviceList, poses);
+
+	int pushed = 0;
+	RawSample sample;
+	sample.time = time;
+	for (int devId : deviceList) {
+		if (devId < 0 || devId >= (int)count || !poses[devId].bPoseIsValid) {
+			if (devId >= 0 && devId < (int)vr::k_unMaxTrackedDeviceCount) {
+				//only the capture thread writes the counters
+				invalidCounts[devId].store(invalidCounts[devId].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
+			continue;
+		}
+		sample.devId = devId;
+		sample.matrix = poses[devId].mDeviceToAbsoluteTracking;
+		sample.velocity = poses[devId].vVelocity;
+		sample.angularVelocity = poses[devId].vAngularVelocity;
+		if (ring.push(sample)) {
+			pushed++;
+		}
+	}
+	return pushed;
+}
+
+int samplePoses(VR& vr, uint64_t devices, int64_t time, SpscRing<RawSample>& ring, std::atomic<long long>* invalidCounts) {
+	if (devices == 0) {
+		return 0;
+	}
+	vr::TrackedDevicePose_t poses[vr::k_unMaxTrackedDeviceCount];
+	uint32_t count = 0;
+	for (uint64_t rest = devices; rest; rest >>= 1) {
+		count++;
+	}
+	vr.readPoses(poses, count);
+
+	int pushed = 0;
+	RawSample sample;
+	sample.time = time;
+	for (uint32_t devId = 0; devId < count; devId++) {
+		if (!(devices >> devId & 1)) {
+			continue;
+		}
+		if (!poses[devId].bPoseIsValid) {
+			invalidCounts[devId].store(invalidCounts[devId].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			continue;
+		}
+		sample.devId = devId;
+		sample.matrix = poses[devId].mDeviceToAbsoluteTracking;
+		sample.velocity = poses[devId].vVelocity;
+		sample.angularVelocity = poses[devId].vAngularVelocity;
+		if (ring.push(sample)) {
+			pushed++;
+		}
+	}
+	return pushed;
+}
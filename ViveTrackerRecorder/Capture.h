@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <openvr.h>
+
+#include "SampleStore.h"
+#include "SpscRing.h"
+#include "VR.h"
+
+/*
+Pose as it comes out of the runtime, before any conversion. Fixed size so it can go through SpscRing.
+*/
+struct RawSample {
+public:
+	int64_t time;
+	uint32_t devId;
+	vr::HmdMatrix34_t matrix;
+	// meters and radians per second, as the runtime reports them
+	vr::HmdVector3_t velocity;
+	vr::HmdVector3_t angularVelocity;
+};
+
+/*
+Reads pose and rotation of a single tracked device and stores it into its track.
+Costs up to two calls into the runtime per device, kept for comparison with trackDevices.
+Returns false if no valid pose could be read.
+*/
+bool trackDevice(VR& vr, int devId, int64_t time, DeviceTrack& track);
+
+/*
+Reads the poses of all recorded devices with one call into the runtime and scatters them
+into the track of each device by its index.
+Returns the number of devices that had a valid pose.
+*/
+int trackDevices(VR& vr, const std::vector<int>& deviceList, int64_t time, SampleStore& samples);
+
+/*
+Capture thread version of trackDevices: reads all poses with one call and pushes the valid ones
+unconverted into the ring. Devices without a valid pose get their invalid counter increased.
+Returns the number of samples that went into the ring.
+*/
+int samplePoses(VR& vr, const std::vector<int>& deviceList, int64_t time, SpscRing<RawSample>& ring, std::atomic<long long>* invalidCounts);
+// Same for the devices whose bits are set, as published by DeviceRegistry
+int samplePoses(VR& vr, uint64_t devices, int64_t time, SpscRing<RawSample>& ring, std::atomic<long long>* invalidCounts);
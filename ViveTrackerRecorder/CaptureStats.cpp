@@ -0,0 +1,88 @@
+#include "CaptureStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+Histogram::Histogram() {
+	clear();
+}
+
+int64_t Histogram::bucketTop(int bucket) {
+	if (bucket < (1 << subBits)) {
+		return bucket;
+	}
+	int shift = (bucket >> subBits) - 1;
+	int64_t low = (int64_t)((1 << subBits) + (bucket & ((1 << subBits) - 1))) << shift;
+	return low + ((int64_t)1 << shift) - 1;
+}
+
+void Histogram::restore(const std::vector<std::pair<int, uint64_t>>& buckets, int64_t minimum, int64_t maximum, int64_t sum) {
+	clear();
+	for (auto& bucket : buckets) {
+		if (bucket.first >= 0 && bucket.first < bucketCount) {
+			counts[bucket.first] += bucket.second;
+			total += bucket.second;
+		}
+	}
+	this->minimum = minimum;
+	this->maximum = maximum;
+	valueSum = sum;
+}
+
+void Histogram::clear() {
+	std::fill(counts, counts + bucketCount, 0);
+	total = 0;
+	minimum = maximum = valueSum = 0;
+}
+
+int64_t Histogram::percentile(double percent) const {
+	if (total == 0) {
+		return 0;
+	}
+	auto rank = (uint64_t)std::ceil(total * std::min(100.0, std::max(0.0, percent)) / 100);
+	rank = std::max<uint64_t>(rank, 1);
+	uint64_t seen = 0;
+	for (int bucket = 0; bucket < bucketCount; bucket++) {
+		seen += counts[bucket];
+		if (seen >= rank) {
+			return std::min(bucketTop(bucket), maximum);
+		}
+	}
+	return maximum;
+}
+
+void printCaptureStats(std::ostream& out, const CaptureStats& stats, const std::vector<RecordedDevice>& names) {
+	auto flags = out.flags();
+	auto precision = out.precision();
+	out << std::fixed << std::setprecision(1);
+	auto& reads = stats.poseReads;
+	out << "Pose reads: " << reads.count() << " ticks, mean " << reads.mean() / 1000 << " us, p99 " << reads.percentile(99) / 1000.0
+		<< " us, max " << reads.highest() / 1000.0 << " us\n";
+	for (auto& device : stats.devices) {
+		std::string name;
+		for (auto& named : names) {
+			if (named.id == device.id) {
+				name = named.name;
+			}
+		}
+		auto& intervals = device.intervals;
+		//n samples have n - 1 intervals between them
+		double seconds = intervals.sum() / 1e9;
+		double rate = seconds > 0 ? intervals.count() / seconds : 0;
+		out << "Device " << device.id << (name.empty() ? "" : " " + name) << ": " << device.samples << " samples at " << rate << " Hz";
+		if (intervals.count() > 0) {
+			out << std::setprecision(3) << ", interval p50 " << intervals.percentile(50) / 1e6 << " ms, p99 " << intervals.percentile(99) / 1e6
+				<< " ms, worst gap " << intervals.highest() / 1e6 << " ms" << std::setprecision(1);
+		}
+		out << ", " << device.invalid << " invalid";
+		if (device.gated > 0) {
+			out << ", " << device.gated << " gated (" << device.gated * DeviceTrack::sampleBytes / 1024.0 << " KB saved)";
+		}
+		out << "\n";
+	}
+	out.flags(flags);
+	out.precision(precision);
+}
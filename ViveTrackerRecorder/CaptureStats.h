@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <utility>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "SampleStore.h"
+
+/*
+Log-linear histogram of durations in nanoseconds, after HdrHistogram: values below 2^subBits are counted exactly,
+every power of two above that is split into 2^subBits buckets, so a value is known to within 1/32 of itself.
+Recording is a bit scan and an increment into a fixed array, it never allocates.
+Values from 2^40 ns (about 18 minutes) on land in the top bucket.
+*/
+class Histogram {
+public:
+	static const int subBits = 5;
+	static const int bucketCount = (40 - subBits + 1) << subBits;
+private:
+	uint64_t counts[bucketCount];
+	uint64_t total = 0;
+	int64_t minimum = 0;
+	int64_t maximum = 0;
+	int64_t valueSum = 0;
+
+	static int highestBit(uint64_t value) {
+#ifdef _MSC_VER
+		//_BitScanReverse64 only exists on x64, values that matter fit into 40 bits anyway
+		unsigned long index;
+		if (_BitScanReverse(&index, (unsigned long)(value >> 32))) {
+			return (int)index + 32;
+		}
+		_BitScanReverse(&index, (unsigned long)value);
+		return (int)index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+public:
+	Histogram();
+
+	static int bucketOf(int64_t value) {
+		if (value < (1 << subBits)) {
+			return value < 0 ? 0 : (int)value;
+		}
+		int top = highestBit((uint64_t)value);
+		if (top >= 40) {
+			return bucketCount - 1;
+		}
+		return ((top - subBits + 1) << subBits) + (int)((value >> (top - subBits)) & ((1 << subBits) - 1));
+	}
+	// The largest value that is counted in a bucket
+	static int64_t bucketTop(int bucket);
+
+	void record(int64_t value) {
+		counts[bucketOf(value)]++;
+		if (total == 0 || value < minimum) {
+			minimum = value;
+		}
+		if (value > maximum) {
+			maximum = value;
+		}
+		valueSum += value;
+		total++;
+	}
+	// Restores a histogram that was written out bucket by bucket
+	void restore(const std::vector<std::pair<int, uint64_t>>& buckets, int64_t minimum, int64_t maximum, int64_t sum);
+	void clear();
+
+	uint64_t count() const {
+		return total;
+	}
+	uint64_t countAt(int bucket) const {
+		return counts[bucket];
+	}
+	// not min() and max(), windows.h defines those as macros
+	int64_t lowest() const {
+		return minimum;
+	}
+	int64_t highest() const {
+		return maximum;
+	}
+	int64_t sum() const {
+		return valueSum;
+	}
+	double mean() const {
+		return total > 0 ? (double)valueSum / total : 0;
+	}
+	// The value below which the given percent of all values lie, as the top of its bucket but never above highest()
+	int64_t percentile(double percent) const;
+};
+
+/*
+What the capture loop measured for one device: intervals are the nanoseconds between two samples of the take,
+gated ones are the samples the motion gate dropped and that are not stored
+*/
+struct DeviceCaptureStats {
+public:
+	uint32_t id = 0;
+	long long samples = 0;
+	long long invalid = 0;
+	long long gated = 0;
+	Histogram intervals;
+};
+
+/*
+Timing of a take as the capture loop saw it. Pose reads are the nanoseconds one tick spent reading
+the poses of all devices and pushing them into the ring.
+*/
+struct CaptureStats {
+public:
+	double rate = 0;
+	Histogram poseReads;
+	std::vector<DeviceCaptureStats> devices;
+};
+
+/*
+One line for the pose reads and one per device: rate, interval percentiles, worst gap, invalid poses
+and, with a motion gate, the samples it dropped and the memory that saved
+*/
+void printCaptureStats(std::ostream& out, const CaptureStats& stats, const std::vector<RecordedDevice>& names);
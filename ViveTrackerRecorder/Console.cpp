@@ -1,14 +1,42 @@
 #include "Console.h"
 
+#include <iostream>
+
+#ifdef _WIN32
 #include <windows.h>
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+#else
+#include <cstdio>
+#include <unistd.h>
+#endif
 
 Console::Console() {
+#ifdef _WIN32
 	handle = GetStdHandle(STD_OUTPUT_HANDLE);
+	DWORD mode = 0;
+	ansi = GetConsoleMode(handle, &mode) && SetConsoleMode(handle, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#else
+	handle = nullptr;
+	ansi = isatty(fileno(stdout)) != 0;
+#endif
 }
 
 void Console::moveCursor(short dy) {
+	if (ansi) {
+		//a count of 0 would still move by one
+		if (dy < 0) {
+			std::cout << "\x1b[" << -dy << "A";
+		} else if (dy > 0) {
+			std::cout << "\x1b[" << dy << "B";
+		}
+		std::cout << "\r";
+		return;
+	}
+#ifdef _WIN32
 	CONSOLE_SCREEN_BUFFER_INFO consoleInfo;
 	GetConsoleScreenBufferInfo(handle, &consoleInfo);
-	SetConsoleCursorPosition(handle, { 0, consoleInfo.dwCursorPosition.Y + dy });
+	SetConsoleCursorPosition(handle, { 0, (SHORT)(consoleInfo.dwCursorPosition.Y + dy) });
+#endif
 }
-
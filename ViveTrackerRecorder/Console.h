@@ -1,9 +1,17 @@
 #pragma once
 
+/*
+Cursor control for the console. Uses ANSI escapes, which Windows 10 consoles understand once virtual terminal
+processing is switched on; consoles that cannot do that fall back to the console API.
+*/
 class Console {
 	void* handle;
+	bool ansi;
 public:
 	Console();
 	void moveCursor(short dy);
-};
 
+	bool usesAnsi() const {
+		return ansi;
+	}
+};
@@ -0,0 +1,157 @@
+#include "ControlServer.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define INVALID_SOCKET (-1)
+#define closesocket close
+#endif
+
+#ifdef MSG_NOSIGNAL
+//a client that is gone must not kill the daemon with SIGPIPE
+static const int sendFlags = MSG_NOSIGNAL;
+#else
+static const int sendFlags = 0;
+#endif
+
+/*
+Sends all of data, false if the client is gone
+*/
+static bool sendAll(intptr_t socket, const std::string& data) {
+	size_t sent = 0;
+	while (sent < data.size()) {
+		int count = send(socket, data.data() + sent, (int)(data.size() - sent), sendFlags);
+		if (count <= 0) {
+			return false;
+		}
+		sent += count;
+	}
+	return true;
+}
+
+ControlServer::ControlServer(uint16_t port) : port(port) {
+#ifdef _WIN32
+	WSADATA wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+		throw std::runtime_error("Could not start Winsock");
+	}
+#endif
+	listener = (intptr_t)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (listener == (intptr_t)INVALID_SOCKET) {
+		throw std::runtime_error("Could not create control socket");
+	}
+	int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 4) != 0) {
+		closesocket(listener);
+		throw std::runtime_error("Could not listen on 127.0.0.1:" + std::to_string(port));
+	}
+	socklen_t length = sizeof(address);
+	getsockname(listener, (sockaddr*)&address, &length);
+	this->port = ntohs(address.sin_port);
+}
+
+ControlServer::~ControlServer() {
+	closesocket(listener);
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+void ControlServer::run(const Handler& handler, const std::atomic<bool>& stop) {
+	while (!stop) {
+		//waits up to 100 ms for a new client or a command of any connected one
+		fd_set set;
+		FD_ZERO(&set);
+		FD_SET(listener, &set);
+		intptr_t highest = listener;
+		for (auto& client : clients) {
+			FD_SET(client.socket, &set);
+			if (client.socket > highest) {
+				highest = client.socket;
+			}
+		}
+		timeval timeout = { 0, 100000 };
+		if (select((int)highest + 1, &set, nullptr, nullptr, &timeout) <= 0) {
+			continue;
+		}
+		for (size_t i = 0; i < clients.size() && !stop;) {
+			if (FD_ISSET(clients[i].socket, &set) && !serve(clients[i], handler)) {
+				closesocket(clients[i].socket);
+				clients.erase(clients.begin() + i);
+			} else {
+				i++;
+			}
+		}
+		if (FD_ISSET(listener, &set)) {
+			accept();
+		}
+	}
+	for (auto& client : clients) {
+		closesocket(client.socket);
+	}
+	clients.clear();
+}
+
+void ControlServer::accept() {
+	intptr_t socket = (intptr_t)::accept(listener, nullptr, nullptr);
+	if (socket == (intptr_t)INVALID_SOCKET) {
+		return;
+	}
+	if (clients.size() >= maxClients) {
+		sendAll(socket, "error too many clients\n");
+		closesocket(socket);
+		return;
+	}
+	int noDelay = 1;
+	setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+#ifdef SO_NOSIGPIPE
+	int noSigPipe = 1;
+	setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, (const char*)&noSigPipe, sizeof(noSigPipe));
+#endif
+	clients.push_back({ socket, "" });
+}
+
+/*
+Reads what the client sent and answers every complete line, false once the client is gone or has to go
+*/
+bool ControlServer::serve(Client& client, const Handler& handler) {
+	char buffer[1024];
+	int received = recv(client.socket, buffer, sizeof(buffer), 0);
+	if (received <= 0) {
+		return false;
+	}
+	client.pending.append(buffer, received);
+	size_t end;
+	while ((end = client.pending.find('\n')) != std::string::npos) {
+		auto command = client.pending.substr(0, end);
+		client.pending.erase(0, end + 1);
+		if (!command.empty() && command.back() == '\r') {
+			command.pop_back();
+		}
+		if (!sendAll(client.socket, handler(command) + "\n")) {
+			return false;
+		}
+	}
+	if (client.pending.size() > maxLineBytes) {
+		sendAll(client.socket, "error line too long\n");
+		return false;
+	}
+	return true;
+}
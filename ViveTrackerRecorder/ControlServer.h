@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+Line based command server on a loopback TCP port, for the daemon mode.
+Every line a client sends is one command and gets exactly one line back, so scripts can use nc or
+a plain socket. It only binds 127.0.0.1, nothing outside this machine can reach it.
+Several clients can stay connected at once, e.g. the slate app with its persistent connection and scripts
+next to it; the thread that calls run() waits on all of them with select and runs their commands one at a time,
+so the handler never runs concurrently. Replies are sent with Nagle disabled, so a command costs one loopback
+round-trip. A line longer than maxLineBytes closes its client.
+*/
+class ControlServer {
+public:
+	// Takes a command without its line break and returns the reply without one
+	typedef std::function<std::string(const std::string& command)> Handler;
+private:
+	struct Client {
+	public:
+		// SOCKET on Windows, a file descriptor elsewhere
+		intptr_t socket;
+		// received bytes of a line that is not complete yet
+		std::string pending;
+	};
+
+	intptr_t listener;
+	uint16_t port;
+	std::vector<Client> clients;
+
+	void accept();
+	bool serve(Client& client, const Handler& handler);
+public:
+	static const size_t maxClients = 16;
+	static const size_t maxLineBytes = 4096;
+
+	// Port 0 picks a free one, see getPort()
+	explicit ControlServer(uint16_t port);
+	~ControlServer();
+	ControlServer(const ControlServer&) = delete;
+	ControlServer& operator=(const ControlServer&) = delete;
+
+	// Serves clients until stop is set, checked at least every 100 ms
+	void run(const Handler& handler, const std::atomic<bool>& stop);
+
+	uint16_t getPort() const {
+		return port;
+	}
+};
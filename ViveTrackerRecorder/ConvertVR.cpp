@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Export.h"
+#include "Journal.h"
+#include "SampleStore.h"
+#include "TakeFile.h"
+#include "ThreadPool.h"
+
+struct ConvertArgs {
+public:
+	std::vector<std::string> inputs;
+	std::string outDir;
+	std::string format = "fbx";
+	// all inputs go into this one FBX file, one animation stack per take
+	std::string mergeFile;
+	size_t threads = 0;
+	ExportOptions exportOptions;
+};
+
+/*
+Reading all arguments, every argument that is not an option is a take to convert
+*/
+bool parseArgs(int argc, char* argv[], ConvertArgs& args) {
+	bool help = argc < 2;
+	for (int i = 1; i < argc; i++) {
+		auto strArg = std::string(argv[i]);
+		if (strArg == "/?" || strArg == "-h" || strArg == "--help") {
+			help = true;
+			break;
+		} else if (strArg == "-outdir") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing directory after -outdir";
+				return false;
+			}
+			args.outDir = argv[i];
+		} else if (strArg == "-format") {
+			i++;
+			if (i >= argc || (std::string(argv[i]) != "fbx" && std::string(argv[i]) != "vtr")) {
+				std::cout << "Format must be fbx or vtr";
+				return false;
+			}
+			args.format = argv[i];
+		} else if (strArg == "-merge") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing filename after -merge";
+				return false;
+			}
+			args.mergeFile = argv[i];
+		} else if (strArg == "-j") {
+			i++;
+			std::string count = i < argc ? argv[i] : "";
+			size_t end = 0;
+			try {
+				//stoul takes a sign, "-1" would be the largest count there is
+				if (count.find_first_not_of("0123456789") == std::string::npos) {
+					args.threads = std::stoul(count, &end);
+				}
+			} catch (const std::exception&) {
+				end = 0;
+			}
+			if (end == 0 || end != count.size() || args.threads == 0) {
+				std::cout << "Invalid thread count";
+				return false;
+			}
+		} else if (strArg == "-precision") {
+			i++;
+			try {
+				args.exportOptions.take.positionStep = std::stod(i < argc ? argv[i] : "") / 1000;
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid precision";
+				return false;
+			}
+		} else if (strArg == "-reduce") {
+			i += 2;
+			try {
+				args.exportOptions.reduce.positionTolerance = std::stod(i < argc ? argv[i - 1] : "") / 1000;
+				args.exportOptions.reduce.rotationTolerance = std::stod(argv[i]);
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid tolerance";
+				return false;
+			}
+		} else if (strArg == "-static") {
+			i += 2;
+			try {
+				args.exportOptions.staticDevices.positionTolerance = std::stod(i < argc ? argv[i - 1] : "") / 1000;
+				args.exportOptions.staticDevices.rotationTolerance = std::stod(i < argc ? argv[i] : "");
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid tolerance";
+				return false;
+			}
+		} else if (strArg == "-fps") {
+			i++;
+			if (i >= argc || !parseFrameRate(argv[i], args.exportOptions.rate)) {
+				std::cout << "Invalid frame rate";
+				return false;
+			}
+		} else if (strArg == "-native") {
+			args.exportOptions.nativeFbx = true;
+		} else if (strArg == "-compress") {
+			args.exportOptions.nativeFbx = true;
+			args.exportOptions.fbx.compress = true;
+		} else if (strArg[0] == '-') {
+			std::cout << "Unknown option: " << argv[i];
+			return false;
+		} else {
+			args.inputs.push_back(strArg);
+		}
+	}
+	if (!help && !args.mergeFile.empty() && isTakeFile(args.mergeFile)) {
+		std::cout << "Only FBX files can hold several takes";
+		return false;
+	}
+	if (help || args.inputs.empty()) {
+		auto appName = std::string(argv[0]);
+		int lastBackslash = appName.rfind('\\');
+		int lastSlash = appName.rfind('/');
+		int x = std::max(lastBackslash, lastSlash);
+		auto nameOnly = appName.substr(x + 1);
+		std::cout << nameOnly << " take.vtr [take.vtr...] [-outdir dir] [-format fbx|vtr] [-merge file.fbx] [-j threads] [-precision mm] [-reduce mm deg] [-static mm deg] [-fps rate] [-native] [-compress]\n\n";
+		std::cout << "take.vtr...        Raw takes (.vtr) or recording journals (.journal) to convert.\n";
+		std::cout << "-outdir dir        Directory to write to (default: next to each input).\n";
+		std::cout << "-format fbx|vtr    Output format (default fbx).\n";
+		std::cout << "-merge file.fbx    Writes all takes into one FBX file, each as its own animation stack.\n";
+		std::cout << "-j threads         Files converted at the same time (default: one per core).\n";
+		std::cout << "-precision mm      Position precision when writing .vtr (default 0.01 mm).\n";
+		std::cout << "-reduce mm deg     Drops FBX keys that are within these tolerances of the recording.\n";
+		std::cout << "-static mm deg     Stores devices whose pose varies less than this (standard deviation) over\n";
+		std::cout << "                   the whole take once: as a static FBX node, or as a single raw sample.\n";
+		std::cout << "-fps rate          Resamples FBX curves to a frame rate, e.g. 24, 23.976, 29.97df or 60.\n";
+		std::cout << "-native            Writes FBX with the built-in writer instead of the Autodesk SDK.\n";
+		std::cout << "-compress          Built-in writer with zlib-compressed key arrays.\n";
+		return false;
+	}
+	return true;
+}
+
+/*
+The input's file name without directory and extension
+*/
+std::string takeName(const std::string& input) {
+	int lastBackslash = input.rfind('\\');
+	int lastSlash = input.rfind('/');
+	int x = std::max(lastBackslash, lastSlash);
+	auto nameOnly = input.substr(x + 1);
+	auto dot = nameOnly.rfind('.');
+	if (dot != std::string::npos) {
+		nameOnly = nameOnly.substr(0, dot);
+	}
+	return nameOnly;
+}
+
+/*
+Output name: the input's name with the new extension, in outDir if one is given
+*/
+std::string outputName(const std::string& input, const ConvertArgs& args) {
+	int lastBackslash = input.rfind('\\');
+	int lastSlash = input.rfind('/');
+	int x = std::max(lastBackslash, lastSlash);
+	auto directory = input.substr(0, x + 1);
+	auto nameOnly = takeName(input);
+	if (!args.outDir.empty()) {
+		directory = args.outDir;
+		if (directory.back() != '/' && directory.back() != '\\') {
+			directory += '/';
+		}
+	}
+	auto output = directory + nameOnly + "." + args.format;
+	if (output == input) {
+		output = directory + nameOnly + "_converted." + args.format;
+	}
+	return output;
+}
+
+/*
+Reads a raw take or recovers a journal, returns the number of samples.
+gated tells whether a motion gate thinned out the take, its keys then have to be interpolated linearly.
+*/
+size_t readInput(const std::string& input, SampleStore& samples, std::vector<RecordedDevice>& devices, bool& gated) {
+	gated = false;
+	if (input.size() > 8 && input.substr(input.size() - 8) == ".journal") {
+		return Journal::recover(input, samples, devices, &gated);
+	}
+	CaptureStats stats;
+	TakeFileOptions takeOptions;
+	size_t count = readTake(input, samples, devices, &stats, &takeOptions);
+	//the header flag also covers a take that was cut off before its gate chunk
+	gated = takeOptions.gated;
+	for (auto& device : stats.devices) {
+		gated = gated || device.gated > 0;
+	}
+	return count;
+}
+
+/*
+Converting a single file, runs on a pool thread
+*/
+std::string convert(const std::string& input, const ConvertArgs& args) {
+	auto start = std::chrono::steady_clock::now();
+	SampleStore samples;
+	std::vector<RecordedDevice> devices;
+	bool gated;
+	size_t count = readInput(input, samples, devices, gated);
+	auto output = outputName(input, args);
+	auto options = args.exportOptions;
+	options.linear = options.linear || gated;
+	auto reports = saveTake(output, samples, devices, options);
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	std::ostringstream result;
+	result << input << " -> " << output << " (" << devices.size() << " devices, " << count << " samples, " << ms << " ms)\n";
+	printReports(result, reports);
+	return result.str();
+}
+
+/*
+Reads all takes at once, one per pool thread, and writes them into a single FBX file
+*/
+int merge(ConvertArgs& args, ThreadPool& pool) {
+	auto start = std::chrono::steady_clock::now();
+	std::vector<SampleStore> takes(args.inputs.size());
+	std::vector<ExportSession> sessions(args.inputs.size());
+	std::vector<std::future<size_t>> counts;
+	//not vector<bool>, the pool threads write their entries concurrently
+	std::vector<char> gated(args.inputs.size(), 0);
+	for (size_t i = 0; i < args.inputs.size(); i++) {
+		sessions[i].name = takeName(args.inputs[i]);
+		sessions[i].samples = &takes[i];
+		auto input = args.inputs[i];
+		auto session = &sessions[i];
+		auto samples = &takes[i];
+		auto takeGated = &gated[i];
+		counts.push_back(pool.submit([input, session, samples, takeGated]() {
+			bool isGated;
+			size_t count = readInput(input, *samples, session->devices, isGated);
+			*takeGated = isGated;
+			return count;
+		}));
+	}
+	size_t total = 0;
+	int failed = 0;
+	for (size_t i = 0; i < counts.size(); i++) {
+		try {
+			total += counts[i].get();
+		} catch (std::exception& e) {
+			std::cout << args.inputs[i] << ": " << e.what() << "\n";
+			failed++;
+		}
+	}
+	if (failed > 0) {
+		return 1;
+	}
+
+	//all cores help building the curves, the stacks are written one after the other
+	args.exportOptions.threads = args.threads;
+	if (std::find(gated.begin(), gated.end(), 1) != gated.end()) {
+		args.exportOptions.linear = true;
+	}
+	try {
+		printReports(std::cout, saveSessions(args.mergeFile, sessions, args.exportOptions));
+	} catch (std::exception& e) {
+		std::cout << args.mergeFile << ": " << e.what() << "\n";
+		return 1;
+	}
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Merged " << sessions.size() << " takes (" << total << " samples) into " << args.mergeFile << " in " << ms << " ms\n";
+	return 0;
+}
+
+/*
+Converts many takes at once, one file per pool thread
+*/
+int main(int argc, char* argv[]) {
+	ConvertArgs args;
+	if (!parseArgs(argc, argv, args)) {
+		return 1;
+	}
+	auto start = std::chrono::steady_clock::now();
+	size_t cores = std::max(1u, std::thread::hardware_concurrency());
+	ThreadPool pool(std::min(args.threads ? args.threads : cores, args.inputs.size()));
+	if (!args.mergeFile.empty()) {
+		return merge(args, pool);
+	}
+	//the cores that are not busy with a file of their own help reducing the curves of each file
+	args.exportOptions.threads = std::max<size_t>(1, cores / pool.size());
+	std::vector<std::future<std::string>> results;
+	for (auto& input : args.inputs) {
+		results.push_back(pool.submit([&args, input]() { return convert(input, args); }));
+	}
+
+	int failed = 0;
+	for (size_t i = 0; i < results.size(); i++) {
+		try {
+			std::cout << results[i].get();
+		} catch (std::exception& e) {
+			std::cout << args.inputs[i] << ": " << e.what() << "\n";
+			failed++;
+		}
+	}
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "\nConverted " << results.size() - failed << " of " << results.size() << " files in " << ms << " ms on " << pool.size() << " threads\n";
+	return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+#include "Curves.h"
+
+#include <algorithm>
+#include <cmath>
+
+//values of FbxTime::EMode, they are stored in files as they are
+enum FbxTimeMode {
+	eFrames120 = 1, eFrames100 = 2, eFrames60 = 3, eFrames50 = 4, eFrames48 = 5, eFrames30 = 6,
+	eNTSCDropFrame = 8, eNTSCFullFrame = 9, ePAL = 10, eFrames24 = 11, eFrames1000 = 12,
+	eFilmFullFrame = 13, eCustom = 14, eFrames96 = 15, eFrames72 = 16, eFrames59dot94 = 17, eFrames119dot88 = 18
+};
+
+// FBX time unit, 1/46186158000 s, the same in the SDK and in files
+static const int64_t fbxTicksPerSecond = 46186158000LL;
+
+int FrameRate::fbxTimeMode() const {
+	if (!valid()) {
+		return eFrames1000;
+	}
+	if (denominator == 1001) {
+		switch (numerator) {
+		case 24000: return eFilmFullFrame;
+		case 30000: return dropFrame ? eNTSCDropFrame : eNTSCFullFrame;
+		case 60000: return eFrames59dot94;
+		case 120000: return eFrames119dot88;
+		}
+	} else if (denominator == 1) {
+		switch (numerator) {
+		case 24: return eFrames24;
+		case 25: return ePAL;
+		case 30: return eFrames30;
+		case 48: return eFrames48;
+		case 50: return eFrames50;
+		case 60: return eFrames60;
+		case 72: return eFrames72;
+		case 96: return eFrames96;
+		case 100: return eFrames100;
+		case 120: return eFrames120;
+		case 1000: return eFrames1000;
+		}
+	}
+	return eCustom;
+}
+
+int64_t FrameRate::fbxTicks(int64_t time) const {
+	//both are split into a whole and a rest part, so they cannot overflow
+	if (!valid()) {
+		int64_t ms = time / 1000000;
+		int64_t rest = time % 1000000;
+		return ms * (fbxTicksPerSecond / 1000) + (rest * (fbxTicksPerSecond / 1000) + 500000) / 1000000;
+	}
+	//ticks per numerator frames; its own split keeps part * rest below numerator squared, for any int numerator
+	int64_t perFrame = fbxTicksPerSecond * denominator;
+	int64_t perPart = perFrame / numerator;
+	int64_t rest = perFrame % numerator;
+	int64_t whole = time / numerator;
+	int64_t part = time % numerator;
+	return whole * perFrame + part * perPart + (part * rest + numerator / 2) / numerator;
+}
+
+size_t DeviceCurves::keyCount() const {
+	size_t keys = 0;
+	for (auto& channel : channels) {
+		keys += channel.size();
+	}
+	return keys;
+}
+
+
+void unwrapEuler(float* x, float* y, float* z, size_t count) {
+	for (size_t i = 1; i < count; i++) {
+		const float previous[3] = { x[i - 1], y[i - 1], z[i - 1] };
+		const float candidates[2][3] = { { x[i], y[i], z[i] }, { x[i] + 180, 180 - y[i], z[i] + 180 } };
+		auto unwrap = [&previous](const float* candidate, float* unwrapped) {
+			float distance = 0;
+			for (int c = 0; c < 3; c++) {
+				unwrapped[c] = candidate[c] - 360 * std::round((candidate[c] - previous[c]) / 360);
+				distance += std::abs(unwrapped[c] - previous[c]);
+			}
+			return distance;
+		};
+		float best[3];
+		float bestDistance = unwrap(candidates[0], best);
+		float mirrored[3];
+		if (unwrap(candidates[1], mirrored) < bestDistance) {
+			std::copy(mirrored, mirrored + 3, best);
+		}
+		x[i] = best[0];
+		y[i] = best[1];
+		z[i] = best[2];
+	}
+}
+
+void trackToEuler(const DeviceTrack& track, float* x, float* y, float* z) {
+	//all four columns come from the same arena, so their chunks line up
+	size_t first = 0;
+	for (size_t c = 0; c < track.qw.chunkCount(); c++) {
+		size_t length = track.qw.chunkLength(c);
+		quaternionsToEuler(track.qx.chunk(c), track.qy.chunk(c), track.qz.chunk(c), track.qw.chunk(c), length, x + first, y + first, z + first);
+		first += length;
+	}
+}
+
+DeviceCurves buildCurves(const std::string& objName, const DeviceTrack& track) {
+	DeviceCurves curves;
+	curves.name = objName;
+	size_t count = track.size();
+	for (auto& channel : curves.channels) {
+		channel.time.resize(count);
+		channel.value.resize(count);
+	}
+
+	// one channel at a time, each pass only touches the time column and the column of that channel
+	for (auto& channel : curves.channels) {
+		for (size_t i = 0; i < count; i++) {
+			channel.time[i] = track.time[i];
+		}
+	}
+	for (size_t i = 0; i < count; i++) {
+		curves.channels[DeviceCurves::TX].value[i] = track.px[i];
+	}
+	for (size_t i = 0; i < count; i++) {
+		curves.channels[DeviceCurves::TY].value[i] = track.py[i];
+	}
+	for (size_t i = 0; i < count; i++) {
+		curves.channels[DeviceCurves::TZ].value[i] = track.pz[i];
+	}
+
+	if (count > 0) {
+		trackToEuler(track, &curves.channels[DeviceCurves::RX].value[0], &curves.channels[DeviceCurves::RY].value[0], &curves.channels[DeviceCurves::RZ].value[0]);
+		unwrapEuler(&curves.channels[DeviceCurves::RX].value[0], &curves.channels[DeviceCurves::RY].value[0], &curves.channels[DeviceCurves::RZ].value[0], count);
+	}
+	return curves;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <openvr.h>
+#include <string>
+#include <vector>
+
+#include "Rotation.h"
+#include "SampleStore.h"
+
+/*
+One animation channel as plain arrays: the keys that end up on a single FBX curve
+*/
+struct Channel {
+public:
+	std::vector<int64_t> time;
+	std::vector<float> value;
+
+	size_t size() const {
+		return time.size();
+	}
+};
+
+/*
+A frame rate as an exact fraction, so NTSC rates like 30000/1001 land on their frames exactly.
+Drop frame only changes how the frames are labelled, not where they are.
+*/
+struct FrameRate {
+public:
+	int numerator = 0;
+	int denominator = 1;
+	bool dropFrame = false;
+
+	bool valid() const {
+		return numerator > 0 && denominator > 0;
+	}
+	double fps() const {
+		return (double)numerator / denominator;
+	}
+	// time of a frame in nanoseconds from the start of the take
+	double frameTime(long long frame) const {
+		return frame * 1e9 * denominator / numerator;
+	}
+	// the FbxTime::EMode that labels frames of this rate, eCustom if FBX has no mode of its own for it
+	int fbxTimeMode() const;
+	// FBX ticks of a channel time: a frame number of this rate, or nanoseconds if the rate is not valid
+	int64_t fbxTicks(int64_t time) const;
+};
+
+/*
+All curves of one device before they are handed to the FBX SDK.
+Translation is in meters, rotation in Euler degrees.
+*/
+struct DeviceCurves {
+public:
+	enum { TX, TY, TZ, RX, RY, RZ, COUNT };
+
+	std::string name;
+	Channel channels[COUNT];
+	// keys are interpolated linearly instead of cubic, set once keys were dropped
+	bool linear = false;
+	// a device that does not move: one key per channel, written as the transform of its node without curves
+	bool isStatic = false;
+	// channel times are nanoseconds, or frame numbers of this rate once the curves were resampled
+	FrameRate rate;
+
+	size_t keyCount() const;
+};
+
+/*
+Makes Euler angles continuous from sample to sample: each triple is replaced by the equivalent one
+(angles +-360, or the mirrored solution x+180, 180-y, z+180) that is closest to the previous triple.
+Without this, curves jump by 360 degrees at +-180 and spin the wrong way round between keys.
+*/
+void unwrapEuler(float* x, float* y, float* z, size_t count);
+
+/*
+Converts all rotations of a track to Euler angles in degrees (not yet unwrapped), one arena chunk
+at a time through the batch kernels
+*/
+void trackToEuler(const DeviceTrack& track, float* x, float* y, float* z);
+
+/*
+Splits a recorded track into its six channels, converting the rotations to unwrapped Euler angles
+*/
+DeviceCurves buildCurves(const std::string& objName, const DeviceTrack& track);
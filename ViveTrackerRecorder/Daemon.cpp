@@ -0,0 +1,203 @@
+#include "Daemon.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "TakeFile.h"
+
+std::string takeFileName(const std::string& filename, int take) {
+	char number[16];
+	snprintf(number, sizeof(number), "_take%03d", take);
+	auto dot = filename.rfind('.');
+	auto slash = filename.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+		return filename + number;
+	}
+	return filename.substr(0, dot) + number + filename.substr(dot);
+}
+
+RecorderDaemon::RecorderDaemon(VR& vr, const DaemonOptions& options, const std::vector<RecordedDevice>& devices, DeviceRegistry* registry)
+	: vr(vr), registry(registry), options(options), devices(devices), exports(options.exportOptions, options.exports) {
+	prepare();
+}
+
+void RecorderDaemon::prepare() {
+	prepared.reset(new Recorder(vr, options.deviceList, options.recorder));
+	prepared->setRegistry(registry);
+	if (armed()) {
+		//captures right away, start then only has to commit what it kept
+		prepared->start();
+	}
+}
+
+bool RecorderDaemon::armed() const {
+	return prepared && options.recorder.preRollSeconds > 0;
+}
+
+RecorderDaemon::~RecorderDaemon() {
+	finish();
+}
+
+void RecorderDaemon::finish() {
+	if (recording) {
+		stop();
+	}
+	exports.wait();
+}
+
+std::string RecorderDaemon::handle(const std::string& command) {
+	std::istringstream words(command);
+	std::string name;
+	words >> name;
+	std::string rest;
+	std::getline(words >> std::ws, rest);
+	try {
+		if (name == "start") {
+			return start(rest);
+		} else if (name == "stop") {
+			return stop();
+		} else if (name == "marker") {
+			return marker(rest);
+		} else if (name == "status") {
+			return status();
+		} else if (name == "devices") {
+			std::ostringstream reply;
+			reply << "ok";
+			if (!registry) {
+				for (auto& dev : devices) {
+					reply << " " << dev.id << ":" << dev.name;
+				}
+				return reply.str();
+			}
+			//while idle nobody else applies the runtime's device events, unless an armed recorder does
+			if (!recording && !armed()) {
+				registry->pollEvents();
+			}
+			uint64_t recorded = registry->recordedDevices();
+			for (auto& info : registry->list()) {
+				reply << " " << info.id << ":" << info.model << ":" << (info.connected ? ((recorded >> info.id & 1) ? "recorded" : "connected") : "disconnected");
+			}
+			return reply.str();
+		} else if (name == "quit") {
+			if (recording) {
+				stop();
+			}
+			quit = true;
+			return "ok quit";
+		}
+	} catch (std::exception& e) {
+		return std::string("error ") + e.what();
+	}
+	return "error unknown command: " + name;
+}
+
+std::string RecorderDaemon::start(const std::string& file) {
+	if (recording) {
+		return "error take " + std::to_string(take) + " is still recording";
+	}
+	//the take's files are opened before anything changes, so a take that cannot start leaves the daemon as it was
+	std::string takeFile = file.empty() ? takeFileName(options.filename, take + 1) : file;
+	if (!prepared) {
+		prepare();
+	}
+	std::vector<RecordedDevice> takeDevices = devices;
+	if (registry) {
+		//catch up with what connected or dropped out while idle, the take's files list the devices as they are now
+		if (!armed()) {
+			registry->pollEvents();
+		}
+		takeDevices.clear();
+		uint64_t recorded = registry->recordedDevices();
+		for (uint32_t devId = 0; devId < vr::k_unMaxTrackedDeviceCount; devId++) {
+			if (recorded >> devId & 1) {
+				takeDevices.push_back(registry->recordedDevice(devId));
+			}
+		}
+	}
+	std::unique_ptr<TakeWriter> takeWriter;
+	if (isTakeFile(takeFile)) {
+		auto takeOptions = options.exportOptions.take;
+		takeOptions.gated = options.recorder.gate.enabled();
+		takeWriter.reset(new TakeWriter(takeFile, takeDevices, takeOptions));
+	}
+	std::unique_ptr<Journal> journal;
+	if (options.journal) {
+		journal.reset(new Journal(takeFile + ".journal", takeDevices, options.recorder.gate.enabled()));
+	}
+	take++;
+	filename = takeFile;
+	devices = std::move(takeDevices);
+	markers.clear();
+	recording = std::move(prepared);
+	if (recording->isCommitted()) {
+		recording->setTakeWriter(std::move(takeWriter));
+		recording->setJournal(std::move(journal));
+		recording->start();
+		return "ok take " + std::to_string(take) + " " + filename;
+	}
+	//an armed recorder is already capturing, its consumer thread takes the files over with the commit
+	recording->commit(std::move(journal), std::move(takeWriter));
+	return "ok take " + std::to_string(take) + " " + filename + " with " + std::to_string(recording->elapsed()) + " ms pre-roll";
+}
+
+std::string RecorderDaemon::stop() {
+	if (!recording) {
+		return "error not recording";
+	}
+	recording->stop();
+	std::unique_ptr<Recorder> finished = std::move(recording);
+	//the next take's recorder is ready before the reply goes out
+	prepare();
+
+	if (!markers.empty()) {
+		std::ofstream file(filename + ".markers.txt");
+		for (auto& marker : markers) {
+			file << marker.first << "\t" << marker.second << "\n";
+		}
+	}
+	std::ostringstream reply;
+	auto stats = finished->captureStats();
+	int64_t worstGap = 0;
+	for (auto& device : stats.devices) {
+		worstGap = std::max(worstGap, device.intervals.highest());
+	}
+	reply << "ok take " << take << " " << finished->elapsed() << " ms " << finished->getScheduler().tickCount() << " ticks "
+		<< finished->ringOverruns() << " overruns " << markers.size() << " markers " << worstGap / 1000 << " us worst gap "
+		<< stats.poseReads.percentile(99) / 1000 << " us p99 read";
+	if (!isTakeFile(filename)) {
+		std::unique_ptr<ExportJob> job(new ExportJob{ filename, options.journal ? filename + ".journal" : "", finished->releaseSamples(), registry ? finished->recordedDevices() : devices });
+		finished.reset();
+		exports.submit(std::move(job));
+	} else if (!finished->takeWriterError().empty()) {
+		reply << ", " << filename << " failed: " << finished->takeWriterError() << (options.journal ? ", the journal is kept" : "");
+	} else if (options.journal) {
+		//the take file is complete, the journal is only needed until then
+		std::remove((filename + ".journal").c_str());
+	}
+	return reply.str();
+}
+
+std::string RecorderDaemon::marker(const std::string& label) {
+	if (!recording) {
+		return "error not recording";
+	}
+	int time = recording->elapsed();
+	markers.push_back({ time, label });
+	return "ok marker " + std::to_string(markers.size()) + " at " + std::to_string(time) + " ms";
+}
+
+std::string RecorderDaemon::status() {
+	std::ostringstream reply;
+	if (recording) {
+		reply << "ok recording take " << take << " " << filename << " " << recording->elapsed() << " ms "
+			<< recording->ringOccupancy() << "/" << recording->ringCapacity() << " buffered " << recording->ringOverruns() << " overruns";
+	} else if (armed()) {
+		reply << "ok armed after take " << take << ", keeping " << options.recorder.preRollSeconds << " s";
+	} else {
+		reply << "ok idle after take " << take;
+	}
+	reply << ", " << exports.pending() << " exports pending, " << exports.failed() << " failed";
+	return reply.str();
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DeviceRegistry.h"
+#include "Export.h"
+#include "ExportQueue.h"
+#include "Recorder.h"
+#include "VR.h"
+
+/*
+The file of a numbered take: the given name with the take number before the extension
+*/
+std::string takeFileName(const std::string& filename, int take);
+
+struct DaemonOptions {
+public:
+	// takes are numbered from this name unless start gives a file
+	std::string filename;
+	std::vector<int> deviceList;
+	RecorderOptions recorder;
+	ExportOptions exportOptions;
+	bool journal = true;
+	size_t exports = 2;
+};
+
+/*
+Long-running recorder that is controlled by commands instead of the keyboard. The VR connection and
+the device list stay open between takes, and the recorder for the next take is set up while idle,
+so start only has to launch its threads. Finished takes go to a background ExportQueue.
+
+Commands, one per line, each answered with one line starting with "ok" or "error":
+  start [file]     starts the next take, into file or the next numbered name; with a pre-roll the take
+                   begins that many seconds back, the idle daemon keeps capturing for it
+  stop             ends the take and queues its export, replies with its worst sample gap and p99 pose read
+  marker [label]   notes the current take time with a label, written to file.markers.txt at stop
+  status           recording or idle, take, time, ring and export state
+  devices          the recorded device ids and names, with a registry all known devices and their state
+  quit             stops a running take, waits for the exports and ends the daemon
+*/
+class RecorderDaemon {
+private:
+	VR& vr;
+	DeviceRegistry* registry;
+	DaemonOptions options;
+	std::vector<RecordedDevice> devices;
+	ExportQueue exports;
+	std::unique_ptr<Recorder> prepared;
+	std::unique_ptr<Recorder> recording;
+	std::string filename;
+	int take = 0;
+	std::vector<std::pair<int, std::string>> markers;
+	bool quit = false;
+
+	void prepare();
+	// The prepared recorder is already capturing into its pre-roll
+	bool armed() const;
+	std::string start(const std::string& file);
+	std::string stop();
+	std::string marker(const std::string& label);
+	std::string status();
+public:
+	// With a registry, devices that connect between or during takes are recorded too
+	RecorderDaemon(VR& vr, const DaemonOptions& options, const std::vector<RecordedDevice>& devices, DeviceRegistry* registry = nullptr);
+	~RecorderDaemon();
+
+	// Runs one command line and returns the reply, called from the control server's thread only
+	std::string handle(const std::string& command);
+
+	// Stops a running take and waits until every take is exported
+	void finish();
+
+	bool quitRequested() const {
+		return quit;
+	}
+	// Export results since the last call, for the daemon's console
+	std::vector<std::string> exportMessages() {
+		return exports.takeMessages();
+	}
+};
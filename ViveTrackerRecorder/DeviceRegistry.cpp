@@ -0,0 +1,119 @@
+#include "DeviceRegistry.h"
+
+#include <algorithm>
+
+static std::string deviceString(vr::IVRSystem* system, int id, vr::ETrackedDeviceProperty prop) {
+	char buffer[vr::k_unMaxPropertyStringSize];
+	vr::ETrackedPropertyError error = vr::TrackedProp_Success;
+	uint32_t length = system->GetStringTrackedDeviceProperty(id, prop, buffer, sizeof(buffer), &error);
+	if (error != vr::TrackedProp_Success || length == 0) {
+		return "";
+	}
+	return std::string(buffer);
+}
+
+DeviceRegistry::DeviceRegistry(VR& vr, const std::vector<int>& wanted) : vr(vr), wanted(wanted), recorded(0) {
+	for (int id = 0; id < (int)vr::k_unMaxTrackedDeviceCount; id++) {
+		devices[id].id = id;
+	}
+}
+
+/*
+The runtime calls happen outside the lock, only the copy into the table holds it
+*/
+void DeviceRegistry::query(int id) {
+	auto system = vr.getSystem();
+	TrackedDeviceInfo info;
+	info.id = id;
+	info.cls = system->GetTrackedDeviceClass(id);
+	info.connected = info.cls != vr::TrackedDeviceClass_Invalid && system->IsTrackedDeviceConnected(id);
+	if (info.cls != vr::TrackedDeviceClass_Invalid) {
+		info.role = system->GetControllerRoleForTrackedDeviceIndex(id);
+		info.model = deviceString(system, id, vr::Prop_ModelNumber_String);
+		info.serial = deviceString(system, id, vr::Prop_SerialNumber_String);
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	devices[id] = info;
+}
+
+bool DeviceRegistry::isRecorded(const TrackedDeviceInfo& info) const {
+	if (!info.connected) {
+		return false;
+	}
+	if (!wanted.empty()) {
+		return std::find(wanted.begin(), wanted.end(), info.id) != wanted.end();
+	}
+	return info.cls == vr::TrackedDeviceClass_HMD || info.cls == vr::TrackedDeviceClass_Controller || info.cls == vr::TrackedDeviceClass_GenericTracker;
+}
+
+void DeviceRegistry::publish() {
+	uint64_t mask = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto& info : devices) {
+			if (isRecorded(info)) {
+				mask |= 1ull << info.id;
+			}
+		}
+	}
+	recorded.store(mask, std::memory_order_release);
+}
+
+void DeviceRegistry::scan() {
+	for (int id = 0; id < (int)vr::k_unMaxTrackedDeviceCount; id++) {
+		query(id);
+	}
+	publish();
+}
+
+int DeviceRegistry::pollEvents() {
+	vr::VREvent_t event;
+	int handled = 0;
+	while (vr.getSystem()->PollNextEvent(&event, sizeof(event))) {
+		if (event.trackedDeviceIndex >= vr::k_unMaxTrackedDeviceCount) {
+			continue;
+		}
+		switch (event.eventType) {
+		case vr::VREvent_TrackedDeviceActivated:
+		case vr::VREvent_TrackedDeviceUpdated:
+		case vr::VREvent_TrackedDeviceRoleChanged:
+			query(event.trackedDeviceIndex);
+			handled++;
+			break;
+		case vr::VREvent_TrackedDeviceDeactivated: {
+			//a deactivated device cannot be asked anymore, what we know about it stays for the export
+			std::lock_guard<std::mutex> lock(mutex);
+			devices[event.trackedDeviceIndex].connected = false;
+			handled++;
+			break;
+		}
+		default:
+			break;
+		}
+	}
+	if (handled > 0) {
+		publish();
+	}
+	return handled;
+}
+
+TrackedDeviceInfo DeviceRegistry::info(int id) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return devices[id];
+}
+
+RecordedDevice DeviceRegistry::recordedDevice(int id) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return { (uint32_t)id, devices[id].model };
+}
+
+std::vector<TrackedDeviceInfo> DeviceRegistry::list() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<TrackedDeviceInfo> result;
+	for (auto& info : devices) {
+		if (info.cls != vr::TrackedDeviceClass_Invalid) {
+			result.push_back(info);
+		}
+	}
+	return result;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <openvr.h>
+
+#include "SampleStore.h"
+#include "VR.h"
+
+struct TrackedDeviceInfo {
+public:
+	int id = 0;
+	vr::ETrackedDeviceClass cls = vr::TrackedDeviceClass_Invalid;
+	vr::ETrackedControllerRole role = vr::TrackedControllerRole_Invalid;
+	std::string model;
+	std::string serial;
+	bool connected = false;
+};
+
+/*
+What the runtime knows about every device index, queried once and then kept up to date from the runtime's
+device events instead of asking for class and properties on every sample.
+The capture thread only reads recordedDevices(), a bit mask that is published after every change, so a tracker
+that wakes up during a take is recorded from its next tick on and one that drops out costs nothing anymore.
+scan() and pollEvents() call into the runtime and belong on a thread off the capture path.
+*/
+class DeviceRegistry {
+private:
+	VR& vr;
+	// empty: every HMD, controller and tracker
+	std::vector<int> wanted;
+	mutable std::mutex mutex;
+	TrackedDeviceInfo devices[vr::k_unMaxTrackedDeviceCount];
+	std::atomic<uint64_t> recorded;
+
+	void query(int id);
+	bool isRecorded(const TrackedDeviceInfo& info) const;
+	void publish();
+public:
+	// wanted are the device ids to record, an empty list records every trackable device
+	DeviceRegistry(VR& vr, const std::vector<int>& wanted);
+
+	// Queries every device index, for the start
+	void scan();
+	// Applies all device events that are waiting in the runtime's queue. Returns the number of device events.
+	int pollEvents();
+
+	// One bit per device index that is connected and recorded
+	uint64_t recordedDevices() const {
+		return recorded.load(std::memory_order_acquire);
+	}
+	TrackedDeviceInfo info(int id) const;
+	// The device as it goes into a take, named by its model
+	RecordedDevice recordedDevice(int id) const;
+	std::vector<TrackedDeviceInfo> list() const;
+};
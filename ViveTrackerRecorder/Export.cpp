@@ -0,0 +1,158 @@
+#include "Export.h"
+
+static std::string deviceName(const RecordedDevice& dev) {
+	return dev.name + " - " + std::to_string(dev.id);
+}
+
+static ReduceReport staticReport(const std::string& name, const PoseSpread& spread) {
+	ReduceReport report;
+	report.name = name;
+	report.keysBefore = spread.samples * DeviceCurves::COUNT;
+	report.maxPositionError = spread.maxPosition;
+	report.maxRotationError = spread.maxRotation;
+	report.isStatic = true;
+	return report;
+}
+
+/*
+One pool job per device. Static devices are found in the same job, their curves are never built.
+*/
+std::vector<DeviceCurves> prepareCurves(const SampleStore& samples, const std::vector<RecordedDevice>& devices, const ExportOptions& options, ThreadPool& pool, std::vector<ReduceReport>& reports) {
+	std::vector<std::future<DeviceCurves>> built;
+	//each job writes its own entry
+	std::vector<PoseSpread> spreads(devices.size());
+	for (size_t d = 0; d < devices.size(); d++) {
+		auto track = &samples[devices[d].id];
+		auto name = deviceName(devices[d]);
+		auto rate = options.rate;
+		auto still = options.staticDevices;
+		auto spread = &spreads[d];
+		built.push_back(pool.submit([track, name, rate, still, spread]() {
+			if (still.enabled()) {
+				*spread = measureSpread(*track);
+				if (isStatic(*spread, still)) {
+					return staticCurves(name, spread->mean);
+				}
+			}
+			return rate.valid() ? resampleCurves(name, *track, rate) : buildCurves(name, *track);
+		}));
+	}
+	std::vector<DeviceCurves> curves;
+	for (auto& deviceCurves : built) {
+		curves.push_back(deviceCurves.get());
+		if (options.linear) {
+			curves.back().linear = true;
+		}
+	}
+
+	if (options.reduce.enabled()) {
+		reports = reduceCurves(curves, options.reduce, pool);
+	}
+	for (size_t d = 0; d < curves.size(); d++) {
+		if (!curves[d].isStatic) {
+			continue;
+		}
+		if (options.reduce.enabled()) {
+			reports[d] = staticReport(curves[d].name, spreads[d]);
+		} else {
+			reports.push_back(staticReport(curves[d].name, spreads[d]));
+		}
+	}
+	return curves;
+}
+
+static std::vector<ExportSession> singleSession(const SampleStore& samples, const std::vector<RecordedDevice>& devices, const ExportOptions& options) {
+	return { { options.fbx.stackName, &samples, devices } };
+}
+
+#ifndef NO_FBXSDK
+std::vector<ReduceReport> exportFbx(Fbx fbx, const SampleStore& samples, const std::vector<RecordedDevice>& devices, const ExportOptions& options) {
+	return exportFbx(fbx, singleSession(samples, devices, options), options);
+}
+
+std::vector<ReduceReport> exportFbx(Fbx fbx, const std::vector<ExportSession>& sessions, const ExportOptions& options) {
+	std::vector<ReduceReport> reports;
+	ThreadPool pool(options.threads);
+	for (auto& session : sessions) {
+		std::vector<ReduceReport> sessionReports;
+		auto curves = prepareCurves(*session.samples, session.devices, options, pool, sessionReports);
+		reports.insert(reports.end(), sessionReports.begin(), sessionReports.end());
+
+		// the FBX SDK is not thread safe, the scene is filled from this thread only
+		auto layer = beginStack(fbx.scene, session.name);
+		for (auto& deviceCurves : curves) {
+			setTransforms(fbx.scene, layer, deviceCurves);
+		}
+		finishStack(fbx.scene, layer);
+	}
+	cleanupFbx(fbx);
+	return reports;
+}
+#endif
+
+std::vector<ReduceReport> exportNative(FbxBinaryWriter& writer, const SampleStore& samples, const std::vector<RecordedDevice>& devices, const ExportOptions& options) {
+	return exportNative(writer, singleSession(samples, devices, options), options);
+}
+
+std::vector<ReduceReport> exportNative(FbxBinaryWriter& writer, const std::vector<ExportSession>& sessions, const ExportOptions& options) {
+	std::vector<ReduceReport> reports;
+	ThreadPool pool(options.threads);
+	for (auto& session : sessions) {
+		writer.beginStack(session.name);
+		if (pool.size() == 1 && !options.rate.valid() && !options.reduce.enabled() && !options.staticDevices.enabled()) {
+			//nothing to gain from building curves first, the writer streams straight from the tracks
+			for (auto& dev : session.devices) {
+				writer.addTrack(deviceName(dev), (*session.samples)[dev.id], options.linear);
+			}
+		} else {
+			//only adding to the file is serial
+			std::vector<ReduceReport> sessionReports;
+			for (auto& deviceCurves : prepareCurves(*session.samples, session.devices, options, pool, sessionReports)) {
+				writer.addCurves(deviceCurves);
+			}
+			reports.insert(reports.end(), sessionReports.begin(), sessionReports.end());
+		}
+	}
+	writer.close();
+	return reports;
+}
+
+std::vector<ReduceReport> saveTake(const std::string& filename, const SampleStore& samples, const std::vector<RecordedDevice>& devices, const ExportOptions& options) {
+	if (isTakeFile(filename)) {
+		std::vector<ReduceReport> reports;
+		//a take with linear keys stays one when it is read back
+		auto takeOptions = options.take;
+		takeOptions.gated = takeOptions.gated || options.linear;
+		TakeWriter writer(filename, devices, takeOptions);
+		for (auto& dev : devices) {
+			auto& track = samples[dev.id];
+			if (options.staticDevices.enabled()) {
+				auto spread = measureSpread(track);
+				if (isStatic(spread, options.staticDevices)) {
+					writer.append(dev.id, spread.mean);
+					reports.push_back(staticReport(deviceName(dev), spread));
+					continue;
+				}
+			}
+			writer.writeTrack(dev.id, track);
+		}
+		writer.close();
+		return reports;
+	}
+	return saveSessions(filename, singleSession(samples, devices, options), options);
+}
+
+std::vector<ReduceReport> saveSessions(const std::string& filename, const std::vector<ExportSession>& sessions, const ExportOptions& options) {
+#ifndef NO_FBXSDK
+	if (!options.nativeFbx) {
+		return exportFbx(setupFbx(filename.c_str(), options.rate), sessions, options);
+	}
+#endif
+	//the stack the file opens with
+	auto fbxOptions = options.fbx;
+	if (!sessions.empty()) {
+		fbxOptions.stackName = sessions.front().name;
+	}
+	FbxBinaryWriter writer(filename, options.rate, fbxOptions);
+	return exportNative(writer, sessions, options);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#ifndef NO_FBXSDK
+#include "FbxExport.h"
+#endif
+#include "FbxBinary.h"
+#include "Reduce.h"
+#include "Resample.h"
+#include "SampleStore.h"
+#include "StaticPose.h"
+#include "TakeFile.h"
+
+/*
+Everything that decides how a take is written, shared by the recorder and the converter
+*/
+struct ExportOptions {
+public:
+	TakeFileOptions take;
+	ReduceOptions reduce;
+	// devices that hardly move over the whole take are stored once, as a static node or a single sample
+	StaticOptions staticDevices;
+	// frame rate FBX curves are resampled to, invalid keeps the recorded samples
+	FrameRate rate;
+	// keys are interpolated linearly, which the tolerance of motion gated takes assumes
+	bool linear = false;
+	// threads used to prepare curves, 0 uses one per hardware thread
+	size_t threads = 0;
+	// writes FBX with FbxBinaryWriter instead of the Autodesk SDK, always on in builds with NO_FBXSDK
+	bool nativeFbx = false;
+	FbxBinaryOptions fbx;
+};
+
+/*
+One recording session of a multi-take FBX file, which becomes its own named animation stack
+*/
+struct ExportSession {
+public:
+	std::string name;
+	const SampleStore* samples;
+	std::vector<RecordedDevice> devices;
+};
+
+/*
+Builds the curves of all devices concurrently on pool, resampled, reduced and checked for static devices as the
+options say; only adding them to the scene or writer is left to do serially. reports gets how much each device
+was reduced and which ones were static.
+*/
+std::vector<DeviceCurves> prepareCurves(const SampleStore& samples, const std::vector<RecordedDevice>& devices, const ExportOptions& options, ThreadPool& pool, std::vector<ReduceReport>& reports);
+
+/*
+Writes the tracks of all devices into an FBX file that was set up with setupFbx, and closes it.
+All devices go into one animation stack named options.fbx.stackName, or one stack per session.
+Returns how much each device was reduced and which ones were static, empty if both are off.
+*/
+#ifndef NO_FBXSDK
+std::vector<ReduceReport> exportFbx(Fbx fbx, const SampleStore& samples, const std::vector<RecordedDevice>& devices, const ExportOptions& options);
+std::vector<ReduceReport> exportFbx(Fbx fbx, const std::vector<ExportSession>& sessions, const ExportOptions& options);
+#endif
+
+/*
+Same for the built-in writer. With a single thread, tracks that are neither resampled, reduced nor checked
+for being static are streamed into it directly.
+*/
+std::vector<ReduceReport> exportNative(FbxBinaryWriter& writer, const SampleStore& samples, const std::vector<RecordedDevice>& devices, const ExportOptions& options);
+std::vector<ReduceReport> exportNative(FbxBinaryWriter& writer, const std::vector<ExportSession>& sessions, const ExportOptions& options);
+
+/*
+Writes a take that is in memory: as raw take if the file name ends in .vtr and as FBX otherwise.
+A raw take keeps a single sample of a static device, the mean pose at the time of its first sample.
+*/
+std::vector<ReduceReport> saveTake(const std::string& filename, const SampleStore& samples, const std::vector<RecordedDevice>& devices, const ExportOptions& options);
+
+/*
+Writes several sessions into one FBX file, one animation stack each; the file opens with the first
+*/
+std::vector<ReduceReport> saveSessions(const std::string& filename, const std::vector<ExportSession>& sessions, const ExportOptions& options);
@@ -0,0 +1,89 @@
+#include "ExportQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <thread>
+
+/*
+Several exports at once share the cores, like the converter does with several files
+*/
+static ExportOptions perExport(ExportOptions options, size_t exports) {
+	size_t cores = std::max(1u, std::thread::hardware_concurrency());
+	if (options.threads == 0) {
+		options.threads = std::max<size_t>(1, cores / exports);
+	}
+	return options;
+}
+
+ExportQueue::ExportQueue(const ExportOptions& options, size_t maxInFlight)
+	: options(perExport(options, std::max<size_t>(1, maxInFlight))), maxInFlight(std::max<size_t>(1, maxInFlight)), pool(this->maxInFlight) {
+}
+
+ExportQueue::~ExportQueue() {
+	wait();
+}
+
+void ExportQueue::submit(std::unique_ptr<ExportJob> job) {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		finished.wait(lock, [this]() { return inFlight < maxInFlight; });
+		inFlight++;
+	}
+	//packaged_task needs a copyable job, the take itself is never copied
+	std::shared_ptr<ExportJob> shared(std::move(job));
+	pool.submit([this, shared]() mutable { run(shared); });
+}
+
+void ExportQueue::run(std::shared_ptr<ExportJob>& take) {
+	auto& job = *take;
+	auto start = std::chrono::steady_clock::now();
+	std::ostringstream result;
+	bool ok = true;
+	try {
+		auto reports = saveTake(job.filename, job.samples, job.devices, options);
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		result << "Exported " << job.filename << " (" << job.samples.totalSamples() << " samples, " << ms << " ms)\n";
+		printReports(result, reports);
+		// the take is safe in the file now, the journal is only needed if we never get here
+		if (!job.journalFile.empty()) {
+			std::remove(job.journalFile.c_str());
+		}
+	} catch (std::exception& e) {
+		result << "Export of " << job.filename << " failed: " << e.what() << "\n";
+		ok = false;
+	}
+	//the samples are freed before the slot is, or one more take than allowed could be in memory
+	take.reset();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	messages.push_back(result.str());
+	if (!ok) {
+		failures++;
+	}
+	inFlight--;
+	finished.notify_all();
+}
+
+void ExportQueue::wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this]() { return inFlight == 0; });
+}
+
+std::vector<std::string> ExportQueue::takeMessages() {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<std::string> result;
+	result.swap(messages);
+	return result;
+}
+
+size_t ExportQueue::pending() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return inFlight;
+}
+
+size_t ExportQueue::failed() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return failures;
+}
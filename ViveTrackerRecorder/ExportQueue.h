@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Export.h"
+#include "SampleStore.h"
+#include "ThreadPool.h"
+
+/*
+A finished take waiting for its export. It owns the samples, the recorder it came from is gone.
+*/
+struct ExportJob {
+public:
+	std::string filename;
+	// removed once the take is safely exported, empty if the take has no journal
+	std::string journalFile;
+	SampleStore samples;
+	std::vector<RecordedDevice> devices;
+};
+
+/*
+Exports finished takes on background threads while the next take is recording.
+At most maxInFlight takes are queued or exporting at a time, so memory stays bounded:
+submit() blocks until one of them is done if the limit is reached.
+*/
+class ExportQueue {
+private:
+	ExportOptions options;
+	size_t maxInFlight;
+	std::mutex mutex;
+	std::condition_variable finished;
+	size_t inFlight = 0;
+	size_t failures = 0;
+	std::vector<std::string> messages;
+	// last member, so its destructor waits for the exports while everything above still exists
+	ThreadPool pool;
+
+	void run(std::shared_ptr<ExportJob>& take);
+public:
+	ExportQueue(const ExportOptions& options, size_t maxInFlight);
+	~ExportQueue();
+	ExportQueue(const ExportQueue&) = delete;
+	ExportQueue& operator=(const ExportQueue&) = delete;
+
+	void submit(std::unique_ptr<ExportJob> job);
+	// Blocks until every submitted take is exported
+	void wait();
+
+	// Results of the exports that finished since the last call, one line per take plus its reduce report
+	std::vector<std::string> takeMessages();
+	size_t pending();
+	size_t failed();
+};
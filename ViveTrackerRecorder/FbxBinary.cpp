@@ -0,0 +1,666 @@
+#include "FbxBinary.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef FBX_ZLIB
+#include <zlib.h>
+#endif
+
+static const uint32_t fbxVersion = 7400;
+static const char headerMagic[23] = "Kaydara FBX Binary  \0\x1a";
+static const char nullRecord[13] = {};
+static const size_t flushBytes = 1 << 20;
+static const size_t blockElements = 4096;
+
+//FileId, CreationTime and the footer id belong together, importers check them against each other
+static const unsigned char fileId[16] = { 0x28, 0xb3, 0x2a, 0xeb, 0xb6, 0x24, 0xcc, 0xc2, 0xbf, 0xc8, 0xb0, 0x2a, 0xa9, 0x2b, 0xfc, 0xf1 };
+static const char creationTime[] = "1970-01-01 10:00:00:000";
+static const unsigned char footerId[16] = { 0xfa, 0xbc, 0xab, 0x09, 0xd0, 0xc8, 0xd4, 0x66, 0xb1, 0x76, 0xfb, 0x83, 0x1c, 0xf7, 0x26, 0x7e };
+static const unsigned char footerMagic[16] = { 0xf8, 0x5a, 0x8c, 0x6a, 0xde, 0xf5, 0xd9, 0x7e, 0xec, 0xe9, 0x0c, 0xe3, 0x75, 0x8f, 0x29, 0x0b };
+
+//KeyAttrFlags: interpolation in the low byte, tangent mode above
+static const int32_t keyCubicAuto = 0x00000108;
+static const int32_t keyLinear = 0x00000004;
+//default tangent weights (0.3333) packed the way FBX stores them
+static const int32_t keyWeights = 218434821;
+
+FbxBinaryWriter::FbxBinaryWriter(const std::string& filename, const FrameRate& rate, const FbxBinaryOptions& options)
+	: file(filename, std::ios::binary | std::ios::trunc), options(options), rate(rate) {
+	if (!file) {
+		throw std::runtime_error("Could not create fbx file: " + filename);
+	}
+#ifndef FBX_ZLIB
+	if (options.compress) {
+		throw std::runtime_error("FBX compression needs a build with zlib (FBX_ZLIB)");
+	}
+#endif
+	buffer.reserve(flushBytes + blockElements * sizeof(int64_t));
+	writeHeader();
+}
+
+/*
+Never throws: a writer that is destroyed while an error unwinds the stack must not throw a second time.
+If that error left a node open inside Objects, the file is left unfinished instead of getting a footer.
+*/
+FbxBinaryWriter::~FbxBinaryWriter() {
+	if (!closed && open.size() != 1) {
+		failed = true;
+	}
+	try {
+		close();
+	} catch (...) {
+	}
+}
+
+/*
+After a failure the file is left as it is, close() no longer writes a footer into it
+*/
+void FbxBinaryWriter::fail(const std::string& message) {
+	failed = true;
+	throw std::runtime_error(message);
+}
+
+void FbxBinaryWriter::write(const void* data, size_t size) {
+	auto bytes = static_cast<const char*>(data);
+	buffer.insert(buffer.end(), bytes, bytes + size);
+	if (buffer.size() >= flushBytes) {
+		flush();
+	}
+}
+
+void FbxBinaryWriter::flush() {
+	file.write(buffer.data(), buffer.size());
+	if (!file) {
+		fail("Could not write the fbx file, the disk may be full");
+	}
+	flushed += buffer.size();
+	buffer.clear();
+}
+
+void FbxBinaryWriter::patch(int64_t at, const void* data, size_t size) {
+	auto bytes = static_cast<const char*>(data);
+	if (at < flushed) {
+		//the part that already went to the file
+		size_t inFile = (size_t)std::min<int64_t>(size, flushed - at);
+		file.seekp(at);
+		file.write(bytes, inFile);
+		file.seekp(flushed);
+		if (!file) {
+			fail("Could not write the fbx file, the disk may be full");
+		}
+		at += inFile;
+		bytes += inFile;
+		size -= inFile;
+	}
+	if (size > 0) {
+		std::memcpy(&buffer[(size_t)(at - flushed)], bytes, size);
+	}
+}
+
+void FbxBinaryWriter::beginNode(const char* name) {
+	if (!open.empty()) {
+		endProperties();
+		open.back().children = true;
+	}
+	OpenNode node;
+	node.start = position();
+	node.properties = 0;
+	node.propertiesEnd = -1;
+	node.children = false;
+	//end offset, property count and property bytes are patched in endNode
+	char header[12] = {};
+	write(header, sizeof(header));
+	uint8_t length = (uint8_t)std::strlen(name);
+	write(&length, 1);
+	write(name, length);
+	node.propertiesStart = position();
+	open.push_back(node);
+}
+
+void FbxBinaryWriter::endProperties() {
+	if (open.back().propertiesEnd < 0) {
+		open.back().propertiesEnd = position();
+	}
+}
+
+void FbxBinaryWriter::endNode() {
+	endProperties();
+	auto node = open.back();
+	open.pop_back();
+	//children are terminated by a null record, and so are nodes without anything in them
+	if (node.children || node.properties == 0) {
+		write(nullRecord, sizeof(nullRecord));
+	}
+	if (position() > UINT32_MAX) {
+		fail("FBX 7.4 files are limited to 4 GB, use compression, -fps or -reduce");
+	}
+	uint32_t header[3] = { (uint32_t)position(), node.properties, (uint32_t)(node.propertiesEnd - node.propertiesStart) };
+	patch(node.start, header, sizeof(header));
+}
+
+int64_t FbxBinaryWriter::property(char type, const void* data, size_t size) {
+	open.back().properties++;
+	write(&type, 1);
+	int64_t at = position();
+	write(data, size);
+	return at;
+}
+
+int64_t FbxBinaryWriter::propertyInt(int32_t value) {
+	return property('I', &value, sizeof(value));
+}
+
+int64_t FbxBinaryWriter::propertyLong(int64_t value) {
+	return property('L', &value, sizeof(value));
+}
+
+void FbxBinaryWriter::propertyDouble(double value) {
+	property('D', &value, sizeof(value));
+}
+
+void FbxBinaryWriter::propertyString(const std::string& value) {
+	uint32_t length = (uint32_t)value.size();
+	property('S', &length, sizeof(length));
+	write(value.data(), value.size());
+}
+
+void FbxBinaryWriter::propertyBytes(const void* data, uint32_t size) {
+	property('R', &size, sizeof(size));
+	write(data, size);
+}
+
+void FbxBinaryWriter::propertyArray(char type, size_t count, size_t elementSize, const std::function<void(void* out, size_t first, size_t count)>& fill) {
+	uint32_t header[3] = { (uint32_t)count, options.compress ? 1u : 0u, 0 };
+	int64_t lengthAt = property(type, header, sizeof(header)) + 8;
+	int64_t dataStart = position();
+	std::vector<char> block(blockElements * elementSize);
+
+	if (!options.compress) {
+		for (size_t first = 0; first < count; first += blockElements) {
+			size_t n = std::min(blockElements, count - first);
+			fill(block.data(), first, n);
+			write(block.data(), n * elementSize);
+		}
+	} else {
+#ifdef FBX_ZLIB
+		z_stream zip = {};
+		if (deflateInit(&zip, Z_DEFAULT_COMPRESSION) != Z_OK) {
+			fail("Could not start compressing the fbx file");
+		}
+		std::vector<char> packed(64 << 10);
+		size_t first = 0;
+		bool finished = false;
+		try {
+			while (!finished) {
+				size_t n = std::min(blockElements, count - first);
+				fill(block.data(), first, n);
+				first += n;
+				int flush = first < count ? Z_NO_FLUSH : Z_FINISH;
+				zip.next_in = reinterpret_cast<Bytef*>(block.data());
+				zip.avail_in = (uInt)(n * elementSize);
+				do {
+					zip.next_out = reinterpret_cast<Bytef*>(packed.data());
+					zip.avail_out = (uInt)packed.size();
+					finished = deflate(&zip, flush) == Z_STREAM_END;
+					write(packed.data(), packed.size() - zip.avail_out);
+				} while (zip.avail_out == 0);
+			}
+		} catch (...) {
+			//a failed write must not leak the stream
+			deflateEnd(&zip);
+			throw;
+		}
+		deflateEnd(&zip);
+#endif
+	}
+
+	uint32_t length = (uint32_t)(position() - dataStart);
+	patch(lengthAt, &length, sizeof(length));
+}
+
+void FbxBinaryWriter::node(const char* name, int32_t value) {
+	beginNode(name);
+	propertyInt(value);
+	endNode();
+}
+
+void FbxBinaryWriter::node(const char* name, const std::string& value) {
+	beginNode(name);
+	propertyString(value);
+	endNode();
+}
+
+/*
+Starts a "P" entry of a Properties70 block, the values follow as further properties
+*/
+void FbxBinaryWriter::p70(const char* name, const char* type, const char* label, const char* flags) {
+	beginNode("P");
+	propertyString(name);
+	propertyString(type);
+	propertyString(label);
+	propertyString(flags);
+}
+
+void FbxBinaryWriter::writeHeader() {
+	write(headerMagic, sizeof(headerMagic));
+	write(&fbxVersion, sizeof(fbxVersion));
+
+	beginNode("FBXHeaderExtension");
+	node("FBXHeaderVersion", 1003);
+	node("FBXVersion", (int32_t)fbxVersion);
+	node("EncryptionType", 0);
+	beginNode("CreationTimeStamp");
+	node("Version", 1000);
+	node("Year", 1970);
+	node("Month", 1);
+	node("Day", 1);
+	node("Hour", 10);
+	node("Minute", 0);
+	node("Second", 0);
+	node("Millisecond", 0);
+	endNode();
+	node("Creator", std::string("ViveTracker-FBX-Recorder"));
+	endNode();
+
+	beginNode("FileId");
+	propertyBytes(fileId, sizeof(fileId));
+	endNode();
+	node("CreationTime", std::string(creationTime));
+	node("Creator", std::string("ViveTracker-FBX-Recorder"));
+
+	//Y up, meters, like setupFbx
+	beginNode("GlobalSettings");
+	node("Version", 1000);
+	beginNode("Properties70");
+	p70("UpAxis", "int", "Integer", ""); propertyInt(1); endNode();
+	p70("UpAxisSign", "int", "Integer", ""); propertyInt(1); endNode();
+	p70("FrontAxis", "int", "Integer", ""); propertyInt(2); endNode();
+	p70("FrontAxisSign", "int", "Integer", ""); propertyInt(1); endNode();
+	p70("CoordAxis", "int", "Integer", ""); propertyInt(0); endNode();
+	p70("CoordAxisSign", "int", "Integer", ""); propertyInt(1); endNode();
+	p70("OriginalUpAxis", "int", "Integer", ""); propertyInt(1); endNode();
+	p70("OriginalUpAxisSign", "int", "Integer", ""); propertyInt(1); endNode();
+	p70("UnitScaleFactor", "double", "Number", ""); propertyDouble(100); endNode();
+	p70("OriginalUnitScaleFactor", "double", "Number", ""); propertyDouble(100); endNode();
+	p70("TimeMode", "enum", "", ""); propertyInt(rate.fbxTimeMode()); endNode();
+	p70("TimeSpanStart", "KTime", "Time", ""); spanStartAt = propertyLong(0); endNode();
+	p70("TimeSpanStop", "KTime", "Time", ""); spanStopAt = propertyLong(0); endNode();
+	p70("CustomFrameRate", "double", "Number", ""); propertyDouble(rate.valid() ? rate.fps() : -1); endNode();
+	endNode();
+	endNode();
+
+	beginNode("Documents");
+	node("Count", 1);
+	beginNode("Document");
+	propertyLong(nextId++);
+	propertyString("Scene");
+	propertyString("Scene");
+	beginNode("Properties70");
+	p70("ActiveAnimStackName", "KString", "", ""); propertyString(options.stackName); endNode();
+	endNode();
+	beginNode("RootNode");
+	propertyLong(0);
+	endNode();
+	endNode();
+	endNode();
+
+	beginNode("References");
+	endNode();
+
+	//object counts are patched in close(), once all devices were added
+	beginNode("Definitions");
+	node("Version", 100);
+	beginNode("Count");
+	totalCountAt = propertyInt(0);
+	endNode();
+	beginNode("ObjectType");
+	propertyString("GlobalSettings");
+	node("Count", 1);
+	endNode();
+	beginNode("ObjectType");
+	propertyString("Model");
+	beginNode("Count");
+	modelCountAt = propertyInt(0);
+	endNode();
+	endNode();
+	beginNode("ObjectType");
+	propertyString("AnimationStack");
+	beginNode("Count");
+	stackCountAt = propertyInt(0);
+	endNode();
+	endNode();
+	beginNode("ObjectType");
+	propertyString("AnimationLayer");
+	beginNode("Count");
+	layerCountAt = propertyInt(0);
+	endNode();
+	endNode();
+	beginNode("ObjectType");
+	propertyString("AnimationCurveNode");
+	beginNode("Count");
+	curveNodeCountAt = propertyInt(0);
+	endNode();
+	endNode();
+	beginNode("ObjectType");
+	propertyString("AnimationCurve");
+	beginNode("Count");
+	curveCountAt = propertyInt(0);
+	endNode();
+	endNode();
+	endNode();
+
+	//Objects stays open until close(), every device is written into it as it comes
+	beginNode("Objects");
+}
+
+void FbxBinaryWriter::beginStack(const std::string& name) {
+	stacks.push_back({ name, nextId, nextId + 1, INT64_MAX, INT64_MIN });
+	nextId += 2;
+}
+
+FbxBinaryWriter::Stack& FbxBinaryWriter::currentStack() {
+	if (stacks.empty()) {
+		beginStack(options.stackName);
+	}
+	return stacks.back();
+}
+
+void FbxBinaryWriter::addSpan(int64_t first, int64_t last) {
+	auto& stack = currentStack();
+	stack.firstTick = std::min(stack.firstTick, first);
+	stack.lastTick = std::max(stack.lastTick, last);
+	firstTick = std::min(firstTick, first);
+	lastTick = std::max(lastTick, last);
+}
+
+int64_t FbxBinaryWriter::model(const std::string& name, const float translation[3], const float rotation[3]) {
+	auto known = modelIds.find(name);
+	if (known != modelIds.end()) {
+		return known->second;
+	}
+	int64_t id = nextId++;
+	modelIds[name] = id;
+	beginNode("Model");
+	propertyLong(id);
+	propertyString(name + std::string("\0\1Model", 7));
+	propertyString("Null");
+	node("Version", 232);
+	beginNode("Properties70");
+	p70("InheritType", "enum", "", ""); propertyInt(1); endNode();
+	p70("DefaultAttributeIndex", "int", "Integer", ""); propertyInt(-1); endNode();
+	p70("Lcl Translation", "Lcl Translation", "", "A");
+	for (int c = 0; c < 3; c++) {
+		propertyDouble(translation ? translation[c] : 0);
+	}
+	endNode();
+	p70("Lcl Rotation", "Lcl Rotation", "", "A");
+	for (int c = 0; c < 3; c++) {
+		propertyDouble(rotation ? rotation[c] : 0);
+	}
+	endNode();
+	p70("Lcl Scaling", "Lcl Scaling", "", "A"); propertyDouble(1); propertyDouble(1); propertyDouble(1); endNode();
+	endNode();
+	beginNode("Shading");
+	property('C', "\1", 1);
+	endNode();
+	node("Culling", std::string("CullingOff"));
+	endNode();
+
+	models++;
+	connections.push_back({ id, 0, "" });
+	return id;
+}
+
+void FbxBinaryWriter::writeCurveNode(int64_t model, const char* name, const char* property, const float defaults[3]) {
+	int64_t id = nextId++;
+	beginNode("AnimationCurveNode");
+	propertyLong(id);
+	propertyString(name + std::string("\0\1AnimCurveNode", 15));
+	propertyString("");
+	beginNode("Properties70");
+	p70("d|X", "Number", "", "A"); propertyDouble(defaults[0]); endNode();
+	p70("d|Y", "Number", "", "A"); propertyDouble(defaults[1]); endNode();
+	p70("d|Z", "Number", "", "A"); propertyDouble(defaults[2]); endNode();
+	endNode();
+	endNode();
+
+	curveNodes++;
+	connections.push_back({ id, currentStack().layerId, "" });
+	connections.push_back({ id, model, property });
+}
+
+void FbxBinaryWriter::writeCurve(int64_t curveNode, const char* component, size_t keys, float first, bool linear,
+	const std::function<void(int64_t* out, size_t first, size_t count)>& times,
+	const std::function<void(float* out, size_t first, size_t count)>& values) {
+	int64_t id = nextId++;
+	beginNode("AnimationCurve");
+	propertyLong(id);
+	propertyString(std::string("\0\1AnimCurve", 11));
+	propertyString("");
+	beginNode("Default");
+	propertyDouble(first);
+	endNode();
+	node("KeyVer", 4009);
+
+	beginNode("KeyTime");
+	propertyArray('l', keys, sizeof(int64_t), [&](void* out, size_t from, size_t count) {
+		times(static_cast<int64_t*>(out), from, count);
+	});
+	endNode();
+	beginNode("KeyValueFloat");
+	propertyArray('f', keys, sizeof(float), [&](void* out, size_t from, size_t count) {
+		values(static_cast<float*>(out), from, count);
+	});
+	endNode();
+
+	//one shared set of key attributes for all keys
+	int32_t flags = linear ? keyLinear : keyCubicAuto;
+	float data[4] = { 0, 0, 0, 0 };
+	std::memcpy(&data[2], &keyWeights, sizeof(float));
+	int32_t refCount = (int32_t)keys;
+	beginNode("KeyAttrFlags");
+	propertyArray('i', 1, sizeof(int32_t), [&](void* out, size_t, size_t) { std::memcpy(out, &flags, sizeof(flags)); });
+	endNode();
+	beginNode("KeyAttrDataFloat");
+	propertyArray('f', 4, sizeof(float), [&](void* out, size_t, size_t) { std::memcpy(out, data, sizeof(data)); });
+	endNode();
+	beginNode("KeyAttrRefCount");
+	propertyArray('i', 1, sizeof(int32_t), [&](void* out, size_t, size_t) { std::memcpy(out, &refCount, sizeof(refCount)); });
+	endNode();
+	endNode();
+
+	curves++;
+	connections.push_back({ id, curveNode, component });
+}
+
+void FbxBinaryWriter::addCurves(const DeviceCurves& deviceCurves) {
+	//a model is shared by all stacks, so only a device that is new to the file can take its pose as transform
+	if (deviceCurves.isStatic && modelIds.find(deviceCurves.name) == modelIds.end()) {
+		float translation[3], rotation[3];
+		for (int c = 0; c < 3; c++) {
+			auto& t = deviceCurves.channels[DeviceCurves::TX + c];
+			auto& r = deviceCurves.channels[DeviceCurves::RX + c];
+			translation[c] = t.size() > 0 ? t.value[0] : 0;
+			rotation[c] = r.size() > 0 ? r.value[0] : 0;
+		}
+		this->model(deviceCurves.name, translation, rotation);
+		return;
+	}
+	int64_t model = this->model(deviceCurves.name);
+	static const char* components[3] = { "d|X", "d|Y", "d|Z" };
+	for (int group = 0; group < 2; group++) {
+		auto channels = &deviceCurves.channels[group * 3];
+		if (channels[0].size() == 0 && channels[1].size() == 0 && channels[2].size() == 0) {
+			continue;
+		}
+		float defaults[3];
+		for (int c = 0; c < 3; c++) {
+			defaults[c] = channels[c].size() > 0 ? channels[c].value[0] : 0;
+		}
+		int64_t curveNode = nextId;
+		writeCurveNode(model, group == 0 ? "T" : "R", group == 0 ? "Lcl Translation" : "Lcl Rotation", defaults);
+		for (int c = 0; c < 3; c++) {
+			auto& channel = channels[c];
+			if (channel.size() == 0) {
+				continue;
+			}
+			addSpan(rate.fbxTicks(channel.time.front()), rate.fbxTicks(channel.time.back()));
+			writeCurve(curveNode, components[c], channel.size(), defaults[c], deviceCurves.linear,
+				[&](int64_t* out, size_t first, size_t count) {
+					for (size_t i = 0; i < count; i++) {
+						out[i] = rate.fbxTicks(channel.time[first + i]);
+					}
+				},
+				[&](float* out, size_t first, size_t count) {
+					std::memcpy(out, &channel.value[first], count * sizeof(float));
+				});
+		}
+	}
+}
+
+void FbxBinaryWriter::addTrack(const std::string& name, const DeviceTrack& track, bool linear) {
+	int64_t model = this->model(name);
+	size_t keys = track.size();
+	if (keys == 0) {
+		return;
+	}
+	addSpan(rate.fbxTicks(track.time[0]), rate.fbxTicks(track.time[keys - 1]));
+	auto times = [&](int64_t* out, size_t first, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			out[i] = rate.fbxTicks(track.time[first + i]);
+		}
+	};
+	auto column = [](const ChunkedArray<float>& values) {
+		return [&values](float* out, size_t first, size_t count) {
+			for (size_t i = 0; i < count; i++) {
+				out[i] = values[first + i];
+			}
+		};
+	};
+
+	float position[3] = { track.px[0], track.py[0], track.pz[0] };
+	int64_t translation = nextId;
+	writeCurveNode(model, "T", "Lcl Translation", position);
+	writeCurve(translation, "d|X", keys, position[0], linear, times, column(track.px));
+	writeCurve(translation, "d|Y", keys, position[1], linear, times, column(track.py));
+	writeCurve(translation, "d|Z", keys, position[2], linear, times, column(track.pz));
+
+	//the Euler angles are the only thing that has to be computed, once for all three curves
+	std::vector<float> euler[3];
+	for (auto& angles : euler) {
+		angles.resize(keys);
+	}
+	trackToEuler(track, euler[0].data(), euler[1].data(), euler[2].data());
+	unwrapEuler(euler[0].data(), euler[1].data(), euler[2].data(), keys);
+	float rotation[3] = { euler[0][0], euler[1][0], euler[2][0] };
+	int64_t rotationNode = nextId;
+	writeCurveNode(model, "R", "Lcl Rotation", rotation);
+	static const char* components[3] = { "d|X", "d|Y", "d|Z" };
+	for (int c = 0; c < 3; c++) {
+		auto& angles = euler[c];
+		writeCurve(rotationNode, components[c], keys, rotation[c], linear, times, [&angles](float* out, size_t first, size_t count) {
+			std::memcpy(out, &angles[first], count * sizeof(float));
+		});
+	}
+}
+
+void FbxBinaryWriter::close() {
+	if (closed) {
+		return;
+	}
+	closed = true;
+	if (failed) {
+		file.close();
+		return;
+	}
+	currentStack();
+	if (firstTick > lastTick) {
+		firstTick = lastTick = 0;
+	}
+
+	//every stack spans the keys of its own devices, all of them share its one layer
+	for (auto& stack : stacks) {
+		if (stack.firstTick > stack.lastTick) {
+			stack.firstTick = stack.lastTick = 0;
+		}
+		beginNode("AnimationStack");
+		propertyLong(stack.id);
+		propertyString(stack.name + std::string("\0\1AnimStack", 11));
+		propertyString("");
+		beginNode("Properties70");
+		p70("LocalStart", "KTime", "Time", ""); propertyLong(stack.firstTick); endNode();
+		p70("LocalStop", "KTime", "Time", ""); propertyLong(stack.lastTick); endNode();
+		p70("ReferenceStart", "KTime", "Time", ""); propertyLong(stack.firstTick); endNode();
+		p70("ReferenceStop", "KTime", "Time", ""); propertyLong(stack.lastTick); endNode();
+		endNode();
+		endNode();
+		beginNode("AnimationLayer");
+		propertyLong(stack.layerId);
+		propertyString(std::string("Base Layer\0\1AnimLayer", 21));
+		propertyString("");
+		endNode();
+		connections.push_back({ stack.layerId, stack.id, "" });
+	}
+	//Objects
+	endNode();
+
+	beginNode("Connections");
+	for (auto& connection : connections) {
+		beginNode("C");
+		propertyString(connection.property.empty() ? "OO" : "OP");
+		propertyLong(connection.child);
+		propertyLong(connection.parent);
+		if (!connection.property.empty()) {
+			propertyString(connection.property);
+		}
+		endNode();
+	}
+	endNode();
+
+	beginNode("Takes");
+	node("Current", std::string(""));
+	for (auto& stack : stacks) {
+		beginNode("Take");
+		propertyString(stack.name);
+		node("FileName", stack.name + ".tak");
+		beginNode("LocalTime");
+		propertyLong(stack.firstTick);
+		propertyLong(stack.lastTick);
+		endNode();
+		beginNode("ReferenceTime");
+		propertyLong(stack.firstTick);
+		propertyLong(stack.lastTick);
+		endNode();
+		endNode();
+	}
+	endNode();
+
+	//end of the top level, then the footer
+	write(nullRecord, sizeof(nullRecord));
+	write(footerId, sizeof(footerId));
+	char zeros[120] = {};
+	write(zeros, 4);
+	int64_t pad = ((position() + 15) & ~15) - position();
+	write(zeros, pad == 0 ? 16 : (size_t)pad);
+	write(&fbxVersion, sizeof(fbxVersion));
+	write(zeros, 120);
+	write(footerMagic, sizeof(footerMagic));
+
+	uint32_t stackCount = (uint32_t)stacks.size();
+	int32_t totalCount = (int32_t)(1 + models + 2 * stackCount + curveNodes + curves);
+	patch(totalCountAt, &totalCount, sizeof(totalCount));
+	patch(modelCountAt, &models, sizeof(models));
+	patch(stackCountAt, &stackCount, sizeof(stackCount));
+	patch(layerCountAt, &stackCount, sizeof(stackCount));
+	patch(curveNodeCountAt, &curveNodes, sizeof(curveNodes));
+	patch(curveCountAt, &curves, sizeof(curves));
+	patch(spanStartAt, &firstTick, sizeof(firstTick));
+	patch(spanStopAt, &lastTick, sizeof(lastTick));
+	flush();
+	file.close();
+	if (!file) {
+		fail("Could not finish the fbx file");
+	}
+}
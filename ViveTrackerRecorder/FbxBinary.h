@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Curves.h"
+#include "SampleStore.h"
+
+struct FbxBinaryOptions {
+public:
+	// zlib-compresses key arrays, needs a build with FBX_ZLIB defined and zlib linked
+	bool compress = false;
+	// stack the file opens with; devices added before any beginStack() go into a stack of this name
+	std::string stackName = "Recorded VR";
+};
+
+/*
+Binary FBX 7.4 writer for the part of FBX the recorder emits, without the Autodesk SDK:
+one null node per device with translation and rotation curves, all devices in a single animation stack
+and layer. Several sessions can go into one file with beginStack(), each as its own named stack;
+a device that is in more than one session is still a single node.
+
+Nodes are streamed to the file as they are added. A node's size is only known once it is complete,
+so its header is patched afterwards: in memory while it is still buffered, in the file otherwise.
+Key arrays are written straight from the tracks or curves, nothing builds a scene first.
+*/
+class FbxBinaryWriter {
+private:
+	struct OpenNode {
+		int64_t start;
+		int64_t propertiesStart;
+		int64_t propertiesEnd;
+		uint32_t properties;
+		bool children;
+	};
+	struct Connection {
+		int64_t child;
+		int64_t parent;
+		std::string property;
+	};
+	struct Stack {
+		std::string name;
+		int64_t id;
+		int64_t layerId;
+		int64_t firstTick;
+		int64_t lastTick;
+	};
+
+	std::ofstream file;
+	std::vector<char> buffer;
+	int64_t flushed = 0;
+	FbxBinaryOptions options;
+	FrameRate rate;
+	std::vector<OpenNode> open;
+	std::vector<Connection> connections;
+	int64_t nextId = 1000000;
+	std::vector<Stack> stacks;
+	std::map<std::string, int64_t> modelIds;
+	uint32_t models = 0;
+	uint32_t curveNodes = 0;
+	uint32_t curves = 0;
+	int64_t firstTick = INT64_MAX;
+	int64_t lastTick = INT64_MIN;
+	// file offsets of values that are only known at the end
+	int64_t spanStartAt, spanStopAt;
+	int64_t modelCountAt, stackCountAt, layerCountAt, curveNodeCountAt, curveCountAt, totalCountAt;
+	bool closed = false;
+	// a write or the size limit failed, the file can no longer be finished
+	bool failed = false;
+
+	int64_t position() const {
+		return flushed + (int64_t)buffer.size();
+	}
+	void write(const void* data, size_t size);
+	void flush();
+	void patch(int64_t at, const void* data, size_t size);
+	[[noreturn]] void fail(const std::string& message);
+
+	void beginNode(const char* name);
+	void endProperties();
+	void endNode();
+	int64_t property(char type, const void* data, size_t size);
+	int64_t propertyInt(int32_t value);
+	int64_t propertyLong(int64_t value);
+	void propertyDouble(double value);
+	void propertyString(const std::string& value);
+	void propertyBytes(const void* data, uint32_t size);
+	// An array property, filled block by block so it never has to exist in memory as a whole
+	void propertyArray(char type, size_t count, size_t elementSize, const std::function<void(void* out, size_t first, size_t count)>& fill);
+
+	void node(const char* name, int32_t value);
+	void node(const char* name, const std::string& value);
+	void p70(const char* name, const char* type, const char* label, const char* flags);
+
+	void writeHeader();
+	Stack& currentStack();
+	void addSpan(int64_t first, int64_t last);
+	// The model of a device, written when the device is first added, with a transform or at the origin
+	int64_t model(const std::string& name, const float translation[3] = nullptr, const float rotation[3] = nullptr);
+	void writeCurve(int64_t curveNode, const char* component, size_t keys, float first, bool linear,
+		const std::function<void(int64_t* out, size_t first, size_t count)>& times,
+		const std::function<void(float* out, size_t first, size_t count)>& values);
+	void writeCurveNode(int64_t model, const char* name, const char* property, const float defaults[3]);
+public:
+	FbxBinaryWriter(const std::string& filename, const FrameRate& rate = FrameRate(), const FbxBinaryOptions& options = FbxBinaryOptions());
+	~FbxBinaryWriter();
+	FbxBinaryWriter(const FbxBinaryWriter&) = delete;
+	FbxBinaryWriter& operator=(const FbxBinaryWriter&) = delete;
+
+	// Devices added from now on go into a new animation stack and layer of this name
+	void beginStack(const std::string& name);
+	// Adds a device whose curves were already built, resampled or reduced; static curves become the transform of its model
+	void addCurves(const DeviceCurves& curves);
+	// Adds a device with one key per recorded sample, streamed from the track's columns; linear keys instead of cubic ones
+	void addTrack(const std::string& name, const DeviceTrack& track, bool linear = false);
+	// Writes the animation stacks, the connections and the footer
+	void close();
+
+	int64_t bytesWritten() const {
+		return position();
+	}
+};
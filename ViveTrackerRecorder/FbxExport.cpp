@@ -1,34 +1,11 @@
 #include "FbxExport.h"
 #include <vector>
 
-vr::HmdVector3_t toEulerAngles(vr::HmdQuaternion_t q) {
-	vr::HmdVector3_t angles;
-
-	// roll (x-axis rotation)
-	double sinr_cosp = 2 * (q.w * q.x + q.y * q.z);
-	double cosr_cosp = 1 - 2 * (q.x * q.x + q.y * q.y);
-	angles.v[0] = std::atan2(sinr_cosp, cosr_cosp);
-
-	// pitch (y-axis rotation)
-	double sinp = 2 * (q.w * q.y - q.z * q.x);
-	if (std::abs(sinp) >= 1)
-		angles.v[1] = std::copysign(M_PI / 2, sinp); // use 90 degrees if out of range
-	else
-		angles.v[1] = std::asin(sinp);
-
-	// yaw (z-axis rotation)
-	double siny_cosp = 2 * (q.w * q.z + q.x * q.y);
-	double cosy_cosp = 1 - 2 * (q.y * q.y + q.z * q.z);
-	angles.v[2] = std::atan2(siny_cosp, cosy_cosp);
-
-	for (int i = 0; i <= 2; i++) {
-		angles.v[i] *= 180 / M_PI;
-	}
-
-	return angles;
+static FbxTime::EMode timeMode(const FrameRate& rate) {
+	return (FbxTime::EMode)rate.fbxTimeMode();
 }
 
-Fbx setupFbx(const char* filename) {
+Fbx setupFbx(const char* filename, const FrameRate& rate) {
 	auto manager = FbxManager::Create();
 	auto settings = FbxIOSettings::Create(manager, IOSROOT);
 	manager->SetIOSettings(settings);
@@ -40,7 +17,11 @@ Fbx setupFbx(const char* filename) {
 
 	auto scene = fbxsdk::FbxScene::Create(manager, "Recorded VR");
 	scene->GetGlobalSettings().SetSystemUnit(FbxSystemUnit::m);
-	scene->GetGlobalSettings().SetTimeMode(FbxTime::eFrames1000);
+	auto mode = timeMode(rate);
+	scene->GetGlobalSettings().SetTimeMode(mode);
+	if (mode == FbxTime::eCustom) {
+		scene->GetGlobalSettings().SetCustomFrameRate(rate.fps());
+	}
 
 	return {
 		manager, exporter, scene
@@ -55,15 +36,68 @@ void cleanupFbx(Fbx fbx) {
 	fbx.manager->Destroy();
 }
 
-void setTransforms(fbxsdk::FbxScene* scene, const std::string& objName, const std::vector<KeyFrame>& frames) {
-	auto node = fbxsdk::FbxNode::Create(scene, objName.c_str());
-	node->LclTranslation.Set(FbxDouble3(0, 0, 0));
-	node->LclRotation.Set(FbxDouble3(0, 0, 0));
-	scene->GetRootNode()->AddChild(node);
+static void addKeys(FbxAnimCurve* curve, const Channel& channel, const DeviceCurves& curves) {
+	int last = 0;
+	FbxTime time;
+	FbxAnimCurveKey key;
+
+	curve->KeyModifyBegin();
+	for (size_t i = 0; i < channel.size(); i++) {
+		//the same conversion as FbxBinaryWriter, so both exporters put keys on the same ticks
+		time.Set(curves.rate.fbxTicks(channel.time[i]));
+		key.Set(time, channel.value[i]);
+		if (curves.linear) {
+			key.SetInterpolation(FbxAnimCurveDef::eInterpolationLinear);
+		}
+		curve->KeyAdd(time, key, &last);
+	}
+	curve->KeyModifyEnd();
+}
 
-	auto animStack = FbxAnimStack::Create(scene, (objName + " stack").c_str());
-	auto animLayer = FbxAnimLayer::Create(scene, (objName + " layer").c_str());
+FbxAnimLayer* beginStack(fbxsdk::FbxScene* scene, const std::string& name) {
+	auto animStack = FbxAnimStack::Create(scene, name.c_str());
+	auto animLayer = FbxAnimLayer::Create(scene, (name + " layer").c_str());
 	animStack->AddMember(animLayer);
+	if (scene->GetSrcObjectCount<FbxAnimStack>() == 1) {
+		scene->SetCurrentAnimationStack(animStack);
+	}
+	return animLayer;
+}
+
+void finishStack(fbxsdk::FbxScene* scene, FbxAnimLayer* layer) {
+	auto animStack = layer->GetDstObject<FbxAnimStack>();
+	FbxTimeSpan span(FBXSDK_TIME_INFINITE, FBXSDK_TIME_MINUS_INFINITE);
+	if (!scene->GetRootNode()->GetAnimationInterval(span, animStack)) {
+		span.Set(FBXSDK_TIME_ZERO, FBXSDK_TIME_ZERO);
+	}
+	animStack->SetLocalTimeSpan(span);
+	animStack->SetReferenceTimeSpan(span);
+
+	FbxTimeSpan timeline;
+	scene->GetGlobalSettings().GetTimelineDefaultTimeSpan(timeline);
+	if (scene->GetSrcObjectCount<FbxAnimStack>() > 1) {
+		span.UnionAssignment(timeline);
+	}
+	scene->GetGlobalSettings().SetTimelineDefaultTimeSpan(span);
+}
+
+void setTransforms(fbxsdk::FbxScene* scene, FbxAnimLayer* animLayer, const DeviceCurves& curves) {
+	auto& objName = curves.name;
+	auto node = scene->GetRootNode()->FindChild(objName.c_str(), false);
+	if (!node) {
+		node = fbxsdk::FbxNode::Create(scene, objName.c_str());
+		node->LclTranslation.Set(FbxDouble3(0, 0, 0));
+		node->LclRotation.Set(FbxDouble3(0, 0, 0));
+		scene->GetRootNode()->AddChild(node);
+	}
+	if (curves.isStatic) {
+		auto value = [&](int c) {
+			return curves.channels[c].size() > 0 ? (double)curves.channels[c].value[0] : 0.0;
+		};
+		node->LclTranslation.Set(FbxDouble3(value(DeviceCurves::TX), value(DeviceCurves::TY), value(DeviceCurves::TZ)));
+		node->LclRotation.Set(FbxDouble3(value(DeviceCurves::RX), value(DeviceCurves::RY), value(DeviceCurves::RZ)));
+		return;
+	}
 
 	auto curveTx = node->LclTranslation.GetCurve(animLayer, FBXSDK_CURVENODE_COMPONENT_X, true);
 	auto curveTy = node->LclTranslation.GetCurve(animLayer, FBXSDK_CURVENODE_COMPONENT_Y, true);
@@ -73,37 +107,14 @@ void setTransforms(fbxsdk::FbxScene* scene, const std::string& objName, const st
 	auto curveRy = node->LclRotation.GetCurve(animLayer, FBXSDK_CURVENODE_COMPONENT_Y, true);
 	auto curveRz = node->LclRotation.GetCurve(animLayer, FBXSDK_CURVENODE_COMPONENT_Z, true);
 
-	curveTx->KeyModifyBegin();
-	curveTy->KeyModifyBegin();
-	curveTz->KeyModifyBegin();
-
-	curveRx->KeyModifyBegin();
-	curveRy->KeyModifyBegin();
-	curveRz->KeyModifyBegin();
-
-	int last[6] = { 0,0,0,0,0,0 };
-
-	FbxTime time;
-	FbxAnimCurveKey key;
-	for (auto frame : frames) {
-		time.SetMilliSeconds(frame.time);
-
-		key.Set(time, frame.position.v[0]); curveTx->KeyAdd(time, key, &last[0]);
-		key.Set(time, frame.position.v[1]); curveTy->KeyAdd(time, key, &last[1]);
-		key.Set(time, frame.position.v[2]); curveTz->KeyAdd(time, key, &last[2]);
-
-		auto euler = toEulerAngles(frame.rotation);
-
-		key.Set(time, euler.v[0]); curveRx->KeyAdd(time, key, &last[3]);
-		key.Set(time, euler.v[1]); curveRy->KeyAdd(time, key, &last[4]);
-		key.Set(time, euler.v[2]); curveRz->KeyAdd(time, key, &last[5]);
-	}
-
-	curveTx->KeyModifyEnd();
-	curveTy->KeyModifyEnd();
-	curveTz->KeyModifyEnd();
+	addKeys(curveTx, curves.channels[DeviceCurves::TX], curves);
+	addKeys(curveTy, curves.channels[DeviceCurves::TY], curves);
+	addKeys(curveTz, curves.channels[DeviceCurves::TZ], curves);
+	addKeys(curveRx, curves.channels[DeviceCurves::RX], curves);
+	addKeys(curveRy, curves.channels[DeviceCurves::RY], curves);
+	addKeys(curveRz, curves.channels[DeviceCurves::RZ], curves);
+}
 
-	curveRx->KeyModifyEnd();
-	curveRy->KeyModifyEnd();
-	curveRz->KeyModifyEnd();
-}
\ No newline at end of file
+void setTransforms(fbxsdk::FbxScene* scene, FbxAnimLayer* animLayer, const std::string& objName, const DeviceTrack& track) {
+	setTransforms(scene, animLayer, buildCurves(objName, track));
+}
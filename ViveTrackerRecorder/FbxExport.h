@@ -1,9 +1,13 @@
 #pragma once
 
 #include <openvr.h>
+#include <string>
 #include <vector>
 #include <fbxsdk.h>
 
+#include "Curves.h"
+#include "SampleStore.h"
+
 struct Fbx {
 public:
 	FbxManager* manager;
@@ -11,16 +15,25 @@ public:
 	FbxScene* scene;
 };
 
-struct KeyFrame {
-public:
-	int time;
-	vr::HmdVector3_t position;
-	vr::HmdQuaternion_t rotation;
 
-	KeyFrame(int time, vr::HmdVector3_t pos, vr::HmdQuaternion_t rot): time(time), position(pos), rotation(rot) {}
-};
+/*
+Creates the scene and exporter; the scene time mode follows the frame rate the curves are resampled to,
+and is milliseconds if they are not
+*/
+Fbx setupFbx(const char* filename, const FrameRate& rate = FrameRate());
+void cleanupFbx(Fbx fbx);
 
+/*
+Creates an animation stack with its single layer; all devices of a session are added to that layer.
+The stack's time span is set by finishStack once they are.
+*/
+FbxAnimLayer* beginStack(fbxsdk::FbxScene* scene, const std::string& name);
+// Sets the stack's time span to the keys of all its devices, and widens the scene's timeline to include it
+void finishStack(fbxsdk::FbxScene* scene, FbxAnimLayer* layer);
 
-Fbx setupFbx(const char* filename);
-void cleanupFbx(Fbx fbx);
-void setTransforms(fbxsdk::FbxScene* scene, const std::string& objName, const std::vector<KeyFrame>& frames);
\ No newline at end of file
+/*
+Adds the curves of a device to a layer. Every device is one node, shared by all stacks it is animated in.
+Static curves set the transform of the node instead.
+*/
+void setTransforms(fbxsdk::FbxScene* scene, FbxAnimLayer* layer, const DeviceCurves& curves);
+void setTransforms(fbxsdk::FbxScene* scene, FbxAnimLayer* layer, const std::string& objName, const DeviceTrack& track);
\ No newline at end of file
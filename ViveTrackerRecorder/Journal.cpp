@@ -0,0 +1,356 @@
+#include "Journal.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static const char journalMagic[4] = { 'V', 'T', 'R', 'J' };
+static const uint32_t journalVersion = 3;
+// version 1 stored sample times as 32 bit milliseconds, version 2 had no flags
+static const uint32_t millisecondVersion = 1;
+static const uint32_t unflaggedVersion = 2;
+static const uint32_t gatedFlag = 1;
+static const uint32_t chunkMagic = 0x4B4E4843; // "CHNK"
+static const uint32_t commitMagic = 0x454E4F44; // "DONE"
+static const size_t initialBytes = 16 << 20;
+
+struct JournalDeviceEntry {
+	uint32_t id;
+	char name[60];
+};
+
+struct JournalHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t deviceCount;
+	uint32_t recordSize;
+	JournalDeviceEntry devices[vr::k_unMaxTrackedDeviceCount];
+	// since version 3
+	uint32_t flags;
+	uint32_t reserved;
+};
+
+struct ChunkHeader {
+	uint32_t magic;
+	uint32_t count;
+	uint64_t sequence;
+};
+
+struct JournalRecord {
+	// nanoseconds
+	int64_t time;
+	uint32_t devId;
+	float px, py, pz;
+	float qx, qy, qz, qw;
+};
+
+struct MillisecondRecord {
+	int32_t time;
+	uint32_t devId;
+	float px, py, pz;
+	float qx, qy, qz, qw;
+};
+
+static JournalRecord readRecord(const char* data, uint32_t version) {
+	JournalRecord record;
+	if (version == millisecondVersion) {
+		MillisecondRecord old;
+		std::memcpy(&old, data, sizeof(old));
+		record.time = (int64_t)old.time * 1000000;
+		record.devId = old.devId;
+		record.px = old.px;
+		record.py = old.py;
+		record.pz = old.pz;
+		record.qx = old.qx;
+		record.qy = old.qy;
+		record.qz = old.qz;
+		record.qw = old.qw;
+	} else {
+		std::memcpy(&record, data, sizeof(record));
+	}
+	return record;
+}
+
+struct ChunkFooter {
+	uint32_t commit;
+	uint32_t checksum;
+};
+
+static uint32_t checksum(const char* data, size_t size) {
+	//FNV-1a, only has to catch torn chunks
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+Journal::Journal(const std::string& filename, const std::vector<RecordedDevice>& devices, bool gated) : filename(filename) {
+#ifdef _WIN32
+	file = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		throw std::runtime_error("Could not create journal: " + filename);
+	}
+#else
+	file = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (file < 0) {
+		throw std::runtime_error("Could not create journal: " + filename);
+	}
+#endif
+	map(initialBytes);
+
+	JournalHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, journalMagic, sizeof(journalMagic));
+	header.version = journalVersion;
+	header.recordSize = sizeof(JournalRecord);
+	header.flags = gated ? gatedFlag : 0;
+	for (auto& device : devices) {
+		if (header.deviceCount >= vr::k_unMaxTrackedDeviceCount) {
+			break;
+		}
+		auto& entry = header.devices[header.deviceCount++];
+		entry.id = device.id;
+		std::strncpy(entry.name, device.name.c_str(), sizeof(entry.name) - 1);
+	}
+	std::memcpy(view, &header, sizeof(header));
+	used = sizeof(header);
+	beginChunk();
+}
+
+Journal::~Journal() {
+	close();
+}
+
+void Journal::map(size_t bytes) {
+#ifdef _WIN32
+	LARGE_INTEGER size;
+	size.QuadPart = bytes;
+	//creating the mapping object grows the file to the mapped size
+	mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, size.HighPart, size.LowPart, NULL);
+	if (!mapping) {
+		throw std::runtime_error("Could not map journal: " + filename);
+	}
+	view = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, bytes));
+#else
+	if (ftruncate(file, bytes) != 0) {
+		throw std::runtime_error("Could not grow journal: " + filename);
+	}
+	void* address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	view = address == MAP_FAILED ? nullptr : static_cast<char*>(address);
+#endif
+	if (!view) {
+		throw std::runtime_error("Could not map journal: " + filename);
+	}
+	mappedBytes = bytes;
+}
+
+void Journal::unmap() {
+	if (!view) {
+		return;
+	}
+#ifdef _WIN32
+	FlushViewOfFile(view, used);
+	UnmapViewOfFile(view);
+	CloseHandle(mapping);
+	mapping = nullptr;
+#else
+	msync(view, used, MS_ASYNC);
+	munmap(view, mappedBytes);
+#endif
+	view = nullptr;
+	mappedBytes = 0;
+}
+
+void Journal::ensure(size_t bytes) {
+	if (used + bytes <= mappedBytes) {
+		return;
+	}
+	size_t newSize = mappedBytes * 2;
+	while (used + bytes > newSize) {
+		newSize *= 2;
+	}
+	unmap();
+	map(newSize);
+}
+
+void Journal::beginChunk() {
+	ensure(sizeof(ChunkHeader));
+	chunkStart = used;
+	chunkCount = 0;
+	ChunkHeader header = { chunkMagic, 0, sequence };
+	std::memcpy(view + used, &header, sizeof(header));
+	used += sizeof(header);
+}
+
+void Journal::addDevice(const RecordedDevice& device) {
+	if (!view) {
+		return;
+	}
+	auto header = reinterpret_cast<JournalHeader*>(view);
+	for (uint32_t i = 0; i < header->deviceCount; i++) {
+		if (header->devices[i].id == device.id) {
+			return;
+		}
+	}
+	if (header->deviceCount >= vr::k_unMaxTrackedDeviceCount) {
+		return;
+	}
+	auto& entry = header->devices[header->deviceCount];
+	std::memset(&entry, 0, sizeof(entry));
+	entry.id = device.id;
+	std::strncpy(entry.name, device.name.c_str(), sizeof(entry.name) - 1);
+	//recovery must never see the count before the entry
+	std::atomic_thread_fence(std::memory_order_release);
+	header->deviceCount++;
+}
+
+void Journal::append(uint32_t devId, const KeyFrame& frame) {
+	//keep room for the footer, a chunk must always be committable without growing
+	ensure(sizeof(JournalRecord) + sizeof(ChunkFooter));
+	JournalRecord record;
+	record.time = frame.time;
+	record.devId = devId;
+	record.px = frame.position.v[0];
+	record.py = frame.position.v[1];
+	record.pz = frame.position.v[2];
+	record.qx = (float)frame.rotation.x;
+	record.qy = (float)frame.rotation.y;
+	record.qz = (float)frame.rotation.z;
+	record.qw = (float)frame.rotation.w;
+	std::memcpy(view + used, &record, sizeof(record));
+	used += sizeof(record);
+	chunkCount++;
+}
+
+void Journal::commit() {
+	if (!view || chunkCount == 0) {
+		return;
+	}
+	ensure(sizeof(ChunkFooter));
+	auto header = reinterpret_cast<ChunkHeader*>(view + chunkStart);
+	header->count = chunkCount;
+
+	ChunkFooter footer;
+	footer.commit = commitMagic;
+	footer.checksum = checksum(view + chunkStart, used - chunkStart);
+	//the marker must not become visible before the samples it covers
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(view + used, &footer, sizeof(footer));
+	used += sizeof(footer);
+
+	//start writing back to disk, but don't wait for it
+#ifdef _WIN32
+	FlushViewOfFile(view + chunkStart, used - chunkStart);
+#else
+	size_t page = chunkStart & ~(size_t)4095;
+	msync(view + page, used - page, MS_ASYNC);
+#endif
+	sequence++;
+	beginChunk();
+}
+
+void Journal::close() {
+	if (!view) {
+		return;
+	}
+	commit();
+	//drop the empty chunk header that was opened after the last commit
+	used = chunkStart;
+	unmap();
+#ifdef _WIN32
+	LARGE_INTEGER size;
+	size.QuadPart = used;
+	SetFilePointerEx(file, size, NULL, FILE_BEGIN);
+	SetEndOfFile(file);
+	CloseHandle(file);
+	file = nullptr;
+#else
+	if (ftruncate(file, used) != 0) {
+		//the file is still valid, just longer than needed
+	}
+	::close(file);
+	file = -1;
+#endif
+}
+
+size_t Journal::recover(const std::string& filename, SampleStore& samples, std::vector<RecordedDevice>& devices, bool* gated) {
+	std::ifstream in(filename, std::ios::binary);
+	if (!in) {
+		throw std::runtime_error("Could not open journal: " + filename);
+	}
+	JournalHeader header;
+	//the flags are read once the version is known, older journals have none
+	header.flags = 0;
+	if (!in.read(reinterpret_cast<char*>(&header), offsetof(JournalHeader, flags)) || std::memcmp(header.magic, journalMagic, sizeof(journalMagic)) != 0) {
+		throw std::runtime_error("Not a journal: " + filename);
+	}
+	bool current = header.version == journalVersion && header.recordSize == sizeof(JournalRecord);
+	bool unflagged = header.version == unflaggedVersion && header.recordSize == sizeof(JournalRecord);
+	bool old = header.version == millisecondVersion && header.recordSize == sizeof(MillisecondRecord);
+	if (!current && !unflagged && !old) {
+		throw std::runtime_error("Unsupported journal version: " + filename);
+	}
+	if (current && !in.read(reinterpret_cast<char*>(&header.flags), sizeof(header.flags) + sizeof(header.reserved))) {
+		throw std::runtime_error("Not a journal: " + filename);
+	}
+	if (gated) {
+		*gated = (header.flags & gatedFlag) != 0;
+	}
+	devices.clear();
+	for (uint32_t i = 0; i < header.deviceCount && i < vr::k_unMaxTrackedDeviceCount; i++) {
+		header.devices[i].name[sizeof(header.devices[i].name) - 1] = 0;
+		devices.push_back({ header.devices[i].id, header.devices[i].name });
+	}
+
+	size_t recovered = 0;
+	uint64_t expected = 0;
+	std::vector<char> chunk;
+	while (true) {
+		ChunkHeader chunkHeader;
+		if (!in.read(reinterpret_cast<char*>(&chunkHeader), sizeof(chunkHeader))) {
+			break;
+		}
+		if (chunkHeader.magic != chunkMagic || chunkHeader.sequence != expected || chunkHeader.count == 0) {
+			break;
+		}
+		size_t payload = (size_t)chunkHeader.count * header.recordSize;
+		chunk.resize(sizeof(chunkHeader) + payload);
+		std::memcpy(chunk.data(), &chunkHeader, sizeof(chunkHeader));
+		ChunkFooter footer;
+		if (!in.read(chunk.data() + sizeof(chunkHeader), payload) || !in.read(reinterpret_cast<char*>(&footer), sizeof(footer))) {
+			break;
+		}
+		if (footer.commit != commitMagic || footer.checksum != checksum(chunk.data(), chunk.size())) {
+			break;
+		}
+		for (uint32_t i = 0; i < chunkHeader.count; i++) {
+			auto record = readRecord(chunk.data() + sizeof(chunkHeader) + (size_t)i * header.recordSize, header.version);
+			if (record.devId >= vr::k_unMaxTrackedDeviceCount) {
+				continue;
+			}
+			vr::HmdVector3_t pos = { { record.px, record.py, record.pz } };
+			vr::HmdQuaternion_t rot;
+			rot.w = record.qw;
+			rot.x = record.qx;
+			rot.y = record.qy;
+			rot.z = record.qz;
+			samples[record.devId].push(record.time, pos, rot);
+			recovered++;
+		}
+		expected++;
+	}
+	return recovered;
+}
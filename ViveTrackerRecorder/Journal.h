@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SampleStore.h"
+
+/*
+Crash-safe log of a take, appended to a memory-mapped file while recording.
+
+Layout: a fixed header with the recorded devices and flags, followed by chunks of samples. The flags tell
+whether a motion gate thinned out the take, which decides how its keys are interpolated when it is recovered.
+Every chunk ends with a commit marker and a checksum that are written last, so after a crash
+everything up to the last complete chunk can be read back with Journal::recover.
+The mapping grows by remapping a larger file, which only ever happens on the writing thread.
+*/
+class Journal {
+private:
+	std::string filename;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int file = -1;
+#endif
+	char* view = nullptr;
+	size_t mappedBytes = 0;
+	size_t used = 0;
+
+	// start of the chunk that is being filled, and how many samples it has so far
+	size_t chunkStart = 0;
+	uint32_t chunkCount = 0;
+	uint64_t sequence = 0;
+
+	void map(size_t bytes);
+	void unmap();
+	void ensure(size_t bytes);
+	void beginChunk();
+public:
+	// gated: a motion gate thins out the samples
+	Journal(const std::string& filename, const std::vector<RecordedDevice>& devices, bool gated = false);
+	~Journal();
+	Journal(const Journal&) = delete;
+	Journal& operator=(const Journal&) = delete;
+
+	// Adds a device that connected during the take to the header, before its first sample. Does nothing for known devices.
+	void addDevice(const RecordedDevice& device);
+	void append(uint32_t devId, const KeyFrame& frame);
+	// Seals the samples appended so far, they survive a crash from now on
+	void commit();
+	void close();
+
+	uint32_t pending() const {
+		return chunkCount;
+	}
+	size_t bytes() const {
+		return used;
+	}
+
+	/*
+	Reads all committed chunks of a journal into samples. Returns the number of recovered samples,
+	throws if the file is not a journal. gated is set from the header.
+	*/
+	static size_t recover(const std::string& filename, SampleStore& samples, std::vector<RecordedDevice>& devices, bool* gated = nullptr);
+};
@@ -0,0 +1,272 @@
+#include "MockVR.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+static vr::HmdMatrix34_t identity() {
+	vr::HmdMatrix34_t m = {};
+	m.m[0][0] = m.m[1][1] = m.m[2][2] = 1;
+	return m;
+}
+
+static long long nowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MockVRSystem::MockVRSystem(uint32_t deviceCount, long long callCostNs) : calls(0), frame(0) {
+	options.deviceCount = std::min<uint32_t>(deviceCount, vr::k_unMaxTrackedDeviceCount);
+	options.callCostNs = callCostNs;
+}
+
+MockVRSystem::MockVRSystem(const MockOptions& options) : options(options), calls(0), frame(0) {
+	this->options.deviceCount = std::min<uint32_t>(options.deviceCount, vr::k_unMaxTrackedDeviceCount);
+}
+
+void MockVRSystem::simulateCall() {
+	//other threads call in too, for device names and properties
+	calls.fetch_add(1, std::memory_order_relaxed);
+	if (options.callCostNs <= 0) {
+		return;
+	}
+	//busy wait, sleeping is far too coarse for a few microseconds
+	auto end = nowNs() + options.callCostNs;
+	while (nowNs() < end) {
+	}
+}
+
+double MockVRSystem::timeAt(long long frame) const {
+	if (options.rate > 0) {
+		return frame / options.rate;
+	}
+	return nowNs() / 1e9;
+}
+
+bool MockVRSystem::droppedOut(uint32_t devId, double t) const {
+	for (auto& dropout : options.dropouts) {
+		if (dropout.devId == devId && t >= dropout.from && t < dropout.to) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+fillPose at where the device is at that time, which stands still during a hold
+*/
+bool MockVRSystem::poseAt(uint32_t devId, double t, vr::TrackedDevicePose_t* pose) {
+	for (auto& hold : options.holds) {
+		if (hold.devId == devId && t >= hold.from && t < hold.to) {
+			if (!fillPose(devId, hold.from, pose)) {
+				return false;
+			}
+			pose->vVelocity = {};
+			pose->vAngularVelocity = {};
+			return true;
+		}
+	}
+	return fillPose(devId, t, pose);
+}
+
+/*
+The same seed, device and frame always give the same answer, whatever else the capture path did
+*/
+bool MockVRSystem::injectInvalid(uint32_t devId, long long frame) const {
+	if (options.invalidShare <= 0) {
+		return false;
+	}
+	//splitmix64 finalizer
+	uint64_t x = ((uint64_t)options.seed << 40) ^ ((uint64_t)devId << 32) ^ (uint64_t)frame;
+	x += 0x9e3779b97f4a7c15ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return (x >> 11) * (1.0 / (1ull << 53)) < options.invalidShare;
+}
+
+bool MockVRSystem::hasDevice(vr::TrackedDeviceIndex_t unDeviceIndex) const {
+	return unDeviceIndex < options.deviceCount;
+}
+
+std::string MockVRSystem::modelName(vr::TrackedDeviceIndex_t unDeviceIndex) const {
+	return unDeviceIndex == 0 ? "Mock HMD" : "Mock Tracker";
+}
+
+/*
+Every device moves on its own circle and spins around the up axis, so the recorded curves are easy to check
+*/
+bool MockVRSystem::fillPose(vr::TrackedDeviceIndex_t unDeviceIndex, double t, vr::TrackedDevicePose_t* pose) {
+	double speed = 1 + unDeviceIndex * 0.1;
+	double angle = t * speed;
+	double c = std::cos(angle), s = std::sin(angle);
+	auto& m = pose->mDeviceToAbsoluteTracking.m;
+	m[0][0] = (float)c;  m[0][1] = 0; m[0][2] = (float)s;  m[0][3] = (float)(c * 0.5 + unDeviceIndex * 0.1);
+	m[1][0] = 0;         m[1][1] = 1; m[1][2] = 0;         m[1][3] = 1.5f;
+	m[2][0] = (float)-s; m[2][1] = 0; m[2][2] = (float)c;  m[2][3] = (float)(s * 0.5);
+	pose->vVelocity.v[0] = (float)(-s * 0.5 * speed);
+	pose->vVelocity.v[2] = (float)(c * 0.5 * speed);
+	pose->vAngularVelocity.v[1] = (float)speed;
+	return true;
+}
+
+void MockVRSystem::GetDeviceToAbsoluteTrackingPose(vr::ETrackingUniverseOrigin eOrigin, float fPredictedSecondsToPhotonsFromNow, vr::TrackedDevicePose_t* pTrackedDevicePoseArray, uint32_t unTrackedDevicePoseArrayCount) {
+	simulateCall();
+	long long current = frame.fetch_add(1, std::memory_order_relaxed);
+	double t = timeAt(current);
+	for (uint32_t i = 0; i < unTrackedDevicePoseArrayCount; i++) {
+		auto pose = &pTrackedDevicePoseArray[i];
+		std::memset(pose, 0, sizeof(*pose));
+		pose->mDeviceToAbsoluteTracking = identity();
+		if (!hasDevice(i) || droppedOut(i, t)) {
+			pose->eTrackingResult = vr::TrackingResult_Uninitialized;
+			continue;
+		}
+		pose->bDeviceIsConnected = true;
+		if (injectInvalid(i, current)) {
+			pose->eTrackingResult = vr::TrackingResult_Running_OutOfRange;
+			continue;
+		}
+		if (!poseAt(i, t, pose)) {
+			pose->eTrackingResult = vr::TrackingResult_Running_OutOfRange;
+			continue;
+		}
+		pose->eTrackingResult = vr::TrackingResult_Running_OK;
+		pose->bPoseIsValid = true;
+	}
+}
+
+bool MockVRSystem::GetControllerStateWithPose(vr::ETrackingUniverseOrigin eOrigin, vr::TrackedDeviceIndex_t unControllerDeviceIndex, vr::VRControllerState_t* pControllerState, uint32_t unControllerStateSize, vr::TrackedDevicePose_t* pTrackedDevicePose) {
+	simulateCall();
+	if (unControllerDeviceIndex == 0 || !IsTrackedDeviceConnected(unControllerDeviceIndex)) {
+		return false;
+	}
+	std::memset(pControllerState, 0, unControllerStateSize);
+	if (pTrackedDevicePose) {
+		//does not advance the frame, only pose array reads do
+		std::memset(pTrackedDevicePose, 0, sizeof(*pTrackedDevicePose));
+		pTrackedDevicePose->bDeviceIsConnected = true;
+		pTrackedDevicePose->bPoseIsValid = poseAt(unControllerDeviceIndex, timeAt(frameCount()), pTrackedDevicePose);
+		pTrackedDevicePose->eTrackingResult = pTrackedDevicePose->bPoseIsValid ? vr::TrackingResult_Running_OK : vr::TrackingResult_Running_OutOfRange;
+	}
+	return true;
+}
+
+bool MockVRSystem::PollNextEvent(vr::VREvent_t* pEvent, uint32_t uncbVREvent) {
+	simulateCall();
+	if (!eventsStarted) {
+		for (uint32_t i = 0; i < vr::k_unMaxTrackedDeviceCount; i++) {
+			if (hasDevice(i)) {
+				reported |= 1ull << i;
+			}
+		}
+		eventsStarted = true;
+	}
+	double t = timeAt(frameCount());
+	for (uint32_t i = 0; i < vr::k_unMaxTrackedDeviceCount; i++) {
+		if (!hasDevice(i)) {
+			continue;
+		}
+		bool connected = !droppedOut(i, t);
+		if (connected == ((reported >> i & 1) != 0)) {
+			continue;
+		}
+		reported ^= 1ull << i;
+		std::memset(pEvent, 0, std::min<size_t>(uncbVREvent, sizeof(vr::VREvent_t)));
+		pEvent->eventType = connected ? vr::VREvent_TrackedDeviceActivated : vr::VREvent_TrackedDeviceDeactivated;
+		pEvent->trackedDeviceIndex = i;
+		return true;
+	}
+	return false;
+}
+
+bool MockVRSystem::GetControllerState(vr::TrackedDeviceIndex_t unControllerDeviceIndex, vr::VRControllerState_t* pControllerState, uint32_t unControllerStateSize) {
+	simulateCall();
+	if (!IsTrackedDeviceConnected(unControllerDeviceIndex)) {
+		return false;
+	}
+	std::memset(pControllerState, 0, unControllerStateSize);
+	return true;
+}
+
+vr::ETrackedDeviceClass MockVRSystem::GetTrackedDeviceClass(vr::TrackedDeviceIndex_t unDeviceIndex) {
+	simulateCall();
+	if (!hasDevice(unDeviceIndex)) {
+		return vr::TrackedDeviceClass_Invalid;
+	}
+	return unDeviceIndex == 0 ? vr::TrackedDeviceClass_HMD : vr::TrackedDeviceClass_GenericTracker;
+}
+
+bool MockVRSystem::IsTrackedDeviceConnected(vr::TrackedDeviceIndex_t unDeviceIndex) {
+	simulateCall();
+	return hasDevice(unDeviceIndex) && !droppedOut(unDeviceIndex, timeAt(frameCount()));
+}
+
+uint32_t MockVRSystem::GetStringTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, char* pchValue, uint32_t unBufferSize, vr::ETrackedPropertyError* pError) {
+	simulateCall();
+	std::string value;
+	if (!hasDevice(unDeviceIndex)) {
+		if (pError) *pError = vr::TrackedProp_InvalidDevice;
+		return 0;
+	}
+	switch (prop) {
+	case vr::Prop_ModelNumber_String: value = modelName(unDeviceIndex); break;
+	case vr::Prop_SerialNumber_String: value = "MOCK-" + std::to_string(unDeviceIndex); break;
+	default:
+		if (pError) *pError = vr::TrackedProp_UnknownProperty;
+		return 0;
+	}
+	uint32_t required = (uint32_t)value.size() + 1;
+	if (!pchValue || unBufferSize < required) {
+		if (pError) *pError = vr::TrackedProp_BufferTooSmall;
+		return required;
+	}
+	std::memcpy(pchValue, value.c_str(), required);
+	if (pError) *pError = vr::TrackedProp_Success;
+	return required;
+}
+
+/*
+Everything below is not used by the recorder and only returns neutral values
+*/
+void MockVRSystem::GetRecommendedRenderTargetSize(uint32_t* pnWidth, uint32_t* pnHeight) { *pnWidth = 0; *pnHeight = 0; }
+vr::HmdMatrix44_t MockVRSystem::GetProjectionMatrix(vr::EVREye eEye, float fNearZ, float fFarZ) { return vr::HmdMatrix44_t(); }
+void MockVRSystem::GetProjectionRaw(vr::EVREye eEye, float* pfLeft, float* pfRight, float* pfTop, float* pfBottom) { *pfLeft = *pfRight = *pfTop = *pfBottom = 0; }
+bool MockVRSystem::ComputeDistortion(vr::EVREye eEye, float fU, float fV, vr::DistortionCoordinates_t* pDistortionCoordinates) { return false; }
+vr::HmdMatrix34_t MockVRSystem::GetEyeToHeadTransform(vr::EVREye eEye) { return identity(); }
+bool MockVRSystem::GetTimeSinceLastVsync(float* pfSecondsSinceLastVsync, uint64_t* pulFrameCounter) { return false; }
+int32_t MockVRSystem::GetD3D9AdapterIndex() { return -1; }
+void MockVRSystem::GetDXGIOutputInfo(int32_t* pnAdapterIndex) { *pnAdapterIndex = -1; }
+void MockVRSystem::GetOutputDevice(uint64_t* pnDevice, vr::ETextureType textureType, VkInstance_T* pInstance) { *pnDevice = 0; }
+bool MockVRSystem::IsDisplayOnDesktop() { return false; }
+bool MockVRSystem::SetDisplayVisibility(bool bIsVisibleOnDesktop) { return false; }
+void MockVRSystem::ResetSeatedZeroPose() {}
+vr::HmdMatrix34_t MockVRSystem::GetSeatedZeroPoseToStandingAbsoluteTrackingPose() { return identity(); }
+vr::HmdMatrix34_t MockVRSystem::GetRawZeroPoseToStandingAbsoluteTrackingPose() { return identity(); }
+uint32_t MockVRSystem::GetSortedTrackedDeviceIndicesOfClass(vr::ETrackedDeviceClass eTrackedDeviceClass, vr::TrackedDeviceIndex_t* punTrackedDeviceIndexArray, uint32_t unTrackedDeviceIndexArrayCount, vr::TrackedDeviceIndex_t unRelativeToTrackedDeviceIndex) { return 0; }
+vr::EDeviceActivityLevel MockVRSystem::GetTrackedDeviceActivityLevel(vr::TrackedDeviceIndex_t unDeviceId) { return vr::k_EDeviceActivityLevel_UserInteraction; }
+void MockVRSystem::ApplyTransform(vr::TrackedDevicePose_t* pOutputPose, const vr::TrackedDevicePose_t* pTrackedDevicePose, const vr::HmdMatrix34_t* pTransform) { *pOutputPose = *pTrackedDevicePose; }
+vr::TrackedDeviceIndex_t MockVRSystem::GetTrackedDeviceIndexForControllerRole(vr::ETrackedControllerRole unDeviceType) { return vr::k_unTrackedDeviceIndexInvalid; }
+vr::ETrackedControllerRole MockVRSystem::GetControllerRoleForTrackedDeviceIndex(vr::TrackedDeviceIndex_t unDeviceIndex) { return vr::TrackedControllerRole_Invalid; }
+bool MockVRSystem::GetBoolTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) { if (pError) *pError = vr::TrackedProp_UnknownProperty; return false; }
+float MockVRSystem::GetFloatTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) { if (pError) *pError = vr::TrackedProp_UnknownProperty; return 0; }
+int32_t MockVRSystem::GetInt32TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) { if (pError) *pError = vr::TrackedProp_UnknownProperty; return 0; }
+uint64_t MockVRSystem::GetUint64TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) { if (pError) *pError = vr::TrackedProp_UnknownProperty; return 0; }
+vr::HmdMatrix34_t MockVRSystem::GetMatrix34TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) { if (pError) *pError = vr::TrackedProp_UnknownProperty; return identity(); }
+uint32_t MockVRSystem::GetArrayTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::PropertyTypeTag_t propType, void* pBuffer, uint32_t unBufferSize, vr::ETrackedPropertyError* pError) { if (pError) *pError = vr::TrackedProp_UnknownProperty; return 0; }
+const char* MockVRSystem::GetPropErrorNameFromEnum(vr::ETrackedPropertyError error) { return "mock"; }
+bool MockVRSystem::PollNextEventWithPose(vr::ETrackingUniverseOrigin eOrigin, vr::VREvent_t* pEvent, uint32_t uncbVREvent, vr::TrackedDevicePose_t* pTrackedDevicePose) { return false; }
+const char* MockVRSystem::GetEventTypeNameFromEnum(vr::EVREventType eType) { return "mock"; }
+vr::HiddenAreaMesh_t MockVRSystem::GetHiddenAreaMesh(vr::EVREye eEye, vr::EHiddenAreaMeshType type) { return vr::HiddenAreaMesh_t(); }
+void MockVRSystem::TriggerHapticPulse(vr::TrackedDeviceIndex_t unControllerDeviceIndex, uint32_t unAxisId, unsigned short usDurationMicroSec) {}
+const char* MockVRSystem::GetButtonIdNameFromEnum(vr::EVRButtonId eButtonId) { return "mock"; }
+const char* MockVRSystem::GetControllerAxisTypeNameFromEnum(vr::EVRControllerAxisType eAxisType) { return "mock"; }
+bool MockVRSystem::IsInputAvailable() { return true; }
+bool MockVRSystem::IsSteamVRDrawingControllers() { return false; }
+bool MockVRSystem::ShouldApplicationPause() { return false; }
+bool MockVRSystem::ShouldApplicationReduceRenderingWork() { return false; }
+vr::EVRFirmwareError MockVRSystem::PerformFirmwareUpdate(vr::TrackedDeviceIndex_t unDeviceIndex) { return vr::VRFirmwareError_None; }
+void MockVRSystem::AcknowledgeQuit_Exiting() {}
+uint32_t MockVRSystem::GetAppContainerFilePaths(char* pchBuffer, uint32_t unBufferSize) { return 0; }
+const char* MockVRSystem::GetRuntimeVersion() { return "mock"; }
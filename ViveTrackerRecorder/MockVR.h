@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <openvr.h>
+
+/*
+A stretch of the mock's time, in seconds, in which a device is switched off or holds still
+*/
+struct MockStretch {
+public:
+	uint32_t devId;
+	double from;
+	double to;
+};
+
+struct MockOptions {
+public:
+	uint32_t deviceCount = 4;
+	long long callCostNs = 0;
+	// every pose read advances the mock's time by 1/rate seconds, so a take comes out the same on every run;
+	// 0 follows the wall clock instead
+	double rate = 0;
+	// share of poses reported as invalid, picked by a hash of seed, device and frame
+	double invalidShare = 0;
+	uint32_t seed = 1;
+	std::vector<MockStretch> dropouts;
+	// the device stays where it was at the start of the stretch and reports no velocity
+	std::vector<MockStretch> holds;
+};
+
+/*
+Stand-in for the SteamVR runtime, so the capture path can run without a headset.
+Device 0 is an HMD, all other devices up to deviceCount are generic trackers moving on circles, unless they hold still.
+Every call into it burns callCostNs to emulate the IPC round-trip to vrserver.
+One GetDeviceToAbsoluteTrackingPose call is one frame: invalid poses and dropouts are decided per frame,
+so they hit the same samples on every run. Dropouts also come out of PollNextEvent as device (de)activations.
+*/
+class MockVRSystem : public vr::IVRSystem {
+private:
+	MockOptions options;
+	// written by the capture thread, read by status calls from others
+	std::atomic<long long> calls;
+	std::atomic<long long> frame;
+	// connection state as last told through events, every existing device starts out connected
+	uint64_t reported = 0;
+	bool eventsStarted = false;
+
+	void simulateCall();
+	bool droppedOut(uint32_t devId, double t) const;
+	bool poseAt(uint32_t devId, double t, vr::TrackedDevicePose_t* pose);
+	bool injectInvalid(uint32_t devId, long long frame) const;
+protected:
+	// Seconds of mock time at the given frame
+	double timeAt(long long frame) const;
+	// Whether there is a device at this index at all, dropouts aside
+	virtual bool hasDevice(vr::TrackedDeviceIndex_t unDeviceIndex) const;
+	virtual std::string modelName(vr::TrackedDeviceIndex_t unDeviceIndex) const;
+	// Fills the pose of an existing device at mock time t, false if it has none at that time
+	virtual bool fillPose(vr::TrackedDeviceIndex_t unDeviceIndex, double t, vr::TrackedDevicePose_t* pose);
+public:
+	MockVRSystem(uint32_t deviceCount, long long callCostNs = 0);
+	explicit MockVRSystem(const MockOptions& options);
+	virtual ~MockVRSystem() {}
+
+	long long callCount() const {
+		return calls.load(std::memory_order_relaxed);
+	}
+	long long frameCount() const {
+		return frame.load(std::memory_order_relaxed);
+	}
+
+	virtual void GetRecommendedRenderTargetSize(uint32_t* pnWidth, uint32_t* pnHeight) override;
+	virtual vr::HmdMatrix44_t GetProjectionMatrix(vr::EVREye eEye, float fNearZ, float fFarZ) override;
+	virtual void GetProjectionRaw(vr::EVREye eEye, float* pfLeft, float* pfRight, float* pfTop, float* pfBottom) override;
+	virtual bool ComputeDistortion(vr::EVREye eEye, float fU, float fV, vr::DistortionCoordinates_t* pDistortionCoordinates) override;
+	virtual vr::HmdMatrix34_t GetEyeToHeadTransform(vr::EVREye eEye) override;
+	virtual bool GetTimeSinceLastVsync(float* pfSecondsSinceLastVsync, uint64_t* pulFrameCounter) override;
+	virtual int32_t GetD3D9AdapterIndex() override;
+	virtual void GetDXGIOutputInfo(int32_t* pnAdapterIndex) override;
+	virtual void GetOutputDevice(uint64_t* pnDevice, vr::ETextureType textureType, VkInstance_T* pInstance = nullptr) override;
+	virtual bool IsDisplayOnDesktop() override;
+	virtual bool SetDisplayVisibility(bool bIsVisibleOnDesktop) override;
+	virtual void GetDeviceToAbsoluteTrackingPose(vr::ETrackingUniverseOrigin eOrigin, float fPredictedSecondsToPhotonsFromNow, vr::TrackedDevicePose_t* pTrackedDevicePoseArray, uint32_t unTrackedDevicePoseArrayCount) override;
+	virtual void ResetSeatedZeroPose() override;
+	virtual vr::HmdMatrix34_t GetSeatedZeroPoseToStandingAbsoluteTrackingPose() override;
+	virtual vr::HmdMatrix34_t GetRawZeroPoseToStandingAbsoluteTrackingPose() override;
+	virtual uint32_t GetSortedTrackedDeviceIndicesOfClass(vr::ETrackedDeviceClass eTrackedDeviceClass, vr::TrackedDeviceIndex_t* punTrackedDeviceIndexArray, uint32_t unTrackedDeviceIndexArrayCount, vr::TrackedDeviceIndex_t unRelativeToTrackedDeviceIndex = vr::k_unTrackedDeviceIndex_Hmd) override;
+	virtual vr::EDeviceActivityLevel GetTrackedDeviceActivityLevel(vr::TrackedDeviceIndex_t unDeviceId) override;
+	virtual void ApplyTransform(vr::TrackedDevicePose_t* pOutputPose, const vr::TrackedDevicePose_t* pTrackedDevicePose, const vr::HmdMatrix34_t* pTransform) override;
+	virtual vr::TrackedDeviceIndex_t GetTrackedDeviceIndexForControllerRole(vr::ETrackedControllerRole unDeviceType) override;
+	virtual vr::ETrackedControllerRole GetControllerRoleForTrackedDeviceIndex(vr::TrackedDeviceIndex_t unDeviceIndex) override;
+	virtual vr::ETrackedDeviceClass GetTrackedDeviceClass(vr::TrackedDeviceIndex_t unDeviceIndex) override;
+	virtual bool IsTrackedDeviceConnected(vr::TrackedDeviceIndex_t unDeviceIndex) override;
+	virtual bool GetBoolTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError = 0L) override;
+	virtual float GetFloatTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError = 0L) override;
+	virtual int32_t GetInt32TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError = 0L) override;
+	virtual uint64_t GetUint64TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError = 0L) override;
+	virtual vr::HmdMatrix34_t GetMatrix34TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError = 0L) override;
+	virtual uint32_t GetArrayTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::PropertyTypeTag_t propType, void* pBuffer, uint32_t unBufferSize, vr::ETrackedPropertyError* pError = 0L) override;
+	virtual uint32_t GetStringTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, char* pchValue, uint32_t unBufferSize, vr::ETrackedPropertyError* pError = 0L) override;
+	virtual const char* GetPropErrorNameFromEnum(vr::ETrackedPropertyError error) override;
+	virtual bool PollNextEvent(vr::VREvent_t* pEvent, uint32_t uncbVREvent) override;
+	virtual bool PollNextEventWithPose(vr::ETrackingUniverseOrigin eOrigin, vr::VREvent_t* pEvent, uint32_t uncbVREvent, vr::TrackedDevicePose_t* pTrackedDevicePose) override;
+	virtual const char* GetEventTypeNameFromEnum(vr::EVREventType eType) override;
+	virtual vr::HiddenAreaMesh_t GetHiddenAreaMesh(vr::EVREye eEye, vr::EHiddenAreaMeshType type = vr::k_eHiddenAreaMesh_Standard) override;
+	virtual bool GetControllerState(vr::TrackedDeviceIndex_t unControllerDeviceIndex, vr::VRControllerState_t* pControllerState, uint32_t unControllerStateSize) override;
+	virtual bool GetControllerStateWithPose(vr::ETrackingUniverseOrigin eOrigin, vr::TrackedDeviceIndex_t unControllerDeviceIndex, vr::VRControllerState_t* pControllerState, uint32_t unControllerStateSize, vr::TrackedDevicePose_t* pTrackedDevicePose) override;
+	virtual void TriggerHapticPulse(vr::TrackedDeviceIndex_t unControllerDeviceIndex, uint32_t unAxisId, unsigned short usDurationMicroSec) override;
+	virtual const char* GetButtonIdNameFromEnum(vr::EVRButtonId eButtonId) override;
+	virtual const char* GetControllerAxisTypeNameFromEnum(vr::EVRControllerAxisType eAxisType) override;
+	virtual bool IsInputAvailable() override;
+	virtual bool IsSteamVRDrawingControllers() override;
+	virtual bool ShouldApplicationPause() override;
+	virtual bool ShouldApplicationReduceRenderingWork() override;
+	virtual vr::EVRFirmwareError PerformFirmwareUpdate(vr::TrackedDeviceIndex_t unDeviceIndex) override;
+	virtual void AcknowledgeQuit_Exiting() override;
+	virtual uint32_t GetAppContainerFilePaths(char* pchBuffer, uint32_t unBufferSize) override;
+	virtual const char* GetRuntimeVersion() override;
+};
@@ -0,0 +1,76 @@
+#include "MotionGate.h"
+
+#include <cmath>
+
+static const double pi = 3.14159265358979323846;
+
+MotionGate::MotionGate(const MotionGateOptions& options) : options(options) {
+	speedSquared = options.speed * options.speed;
+	double angularSpeed = options.angularSpeed * pi / 180;
+	angularSpeedSquared = angularSpeed * angularSpeed;
+	positionLimitSquared = options.positionTolerance * options.positionTolerance / 4;
+	//two unit quaternions that are the rotation angle apart lie 2 sin(angle / 4) apart, which stays precise for small angles
+	double rotationLimit = 2 * std::sin(options.rotationTolerance / 2 * pi / 180 / 4);
+	rotationLimitSquared = rotationLimit * rotationLimit;
+	heartbeatNs = (int64_t)(options.heartbeat * 1e9);
+}
+
+bool MotionGate::isStill(const vr::HmdVector3_t& velocity, const vr::HmdVector3_t& angularVelocity) const {
+	double v = (double)velocity.v[0] * velocity.v[0] + (double)velocity.v[1] * velocity.v[1] + (double)velocity.v[2] * velocity.v[2];
+	double w = (double)angularVelocity.v[0] * angularVelocity.v[0] + (double)angularVelocity.v[1] * angularVelocity.v[1]
+		+ (double)angularVelocity.v[2] * angularVelocity.v[2];
+	return v < speedSquared && w < angularSpeedSquared;
+}
+
+/*
+Within half the tolerance, for position and rotation both
+*/
+bool MotionGate::within(const KeyFrame& anchor, const KeyFrame& frame) const {
+	double distance = 0;
+	for (int c = 0; c < 3; c++) {
+		double d = (double)frame.position.v[c] - anchor.position.v[c];
+		distance += d * d;
+	}
+	if (distance > positionLimitSquared) {
+		return false;
+	}
+	auto& a = anchor.rotation;
+	auto& b = frame.rotation;
+	//q and -q are the same rotation
+	double sign = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z < 0 ? -1 : 1;
+	double dw = b.w * sign - a.w, dx = b.x * sign - a.x, dy = b.y * sign - a.y, dz = b.z * sign - a.z;
+	return dw * dw + dx * dx + dy * dy + dz * dz <= rotationLimitSquared;
+}
+
+int MotionGate::pass(uint32_t devId, const KeyFrame& frame, bool still, KeyFrame* kept) {
+	auto& gate = devices[devId];
+	if (gate.anchored && still && frame.time - gate.anchor.time < heartbeatNs && within(gate.anchor, frame)) {
+		gate.held = frame;
+		gate.holding = true;
+		gate.gated++;
+		return 0;
+	}
+	int count = 0;
+	//a frame that strayed too far cannot close the stretch, the last one held back can
+	if (gate.holding && !within(gate.anchor, frame)) {
+		kept[count++] = gate.held;
+		gate.gated--;
+	}
+	gate.holding = false;
+	kept[count++] = frame;
+	gate.anchor = frame;
+	gate.anchored = true;
+	return count;
+}
+
+bool MotionGate::flush(uint32_t devId, KeyFrame& frame) {
+	auto& gate = devices[devId];
+	if (!gate.holding) {
+		return false;
+	}
+	frame = gate.held;
+	gate.anchor = gate.held;
+	gate.holding = false;
+	gate.gated--;
+	return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <openvr.h>
+
+#include "SampleStore.h"
+
+/*
+When a device counts as still, and how far the stored samples of a still device may stray from the recorded ones.
+A tolerance of 0 on both keeps every sample.
+*/
+struct MotionGateOptions {
+public:
+	double positionTolerance = 0; // meters
+	double rotationTolerance = 0; // degrees
+	// below both speeds the runtime reports, a device counts as still
+	double speed = 0.01; // meters per second
+	double angularSpeed = 5; // degrees per second
+	// a still device keeps at least one sample this often
+	double heartbeat = 1; // seconds
+
+	bool enabled() const {
+		return positionTolerance > 0 || rotationTolerance > 0;
+	}
+};
+
+/*
+Thins out the samples of devices that hold still. A moving device keeps every sample. A still one only keeps
+a sample once per heartbeat, or once it strays more than half the tolerance from the last kept sample; the last
+sample held back before that is kept as well, so every stretch of dropped samples ends in a key at its boundary.
+The keys around a stretch of dropped samples are its anchor and a key within half the tolerance of it, and every
+dropped sample is within half the tolerance of the anchor as well. A point on the straight line between the two
+keys is then at most half the tolerance from the anchor, so each dropped sample lies within the full tolerance of
+the linearly interpolated position. The exporter interpolates the Euler channels linearly too, which for the small
+rotations within a stretch stays close to, but is not exactly, the same bound on the rotation angle.
+Keeps no more than a frame per device, all decisions are made as the samples come in.
+*/
+class MotionGate {
+private:
+	struct DeviceGate {
+	public:
+		bool anchored = false;
+		bool holding = false;
+		// the last kept sample and the last dropped one
+		KeyFrame anchor = KeyFrame(0, {}, {});
+		KeyFrame held = KeyFrame(0, {}, {});
+		long long gated = 0;
+	};
+
+	MotionGateOptions options;
+	DeviceGate devices[vr::k_unMaxTrackedDeviceCount];
+	// precomputed for the comparisons per sample
+	double speedSquared;
+	double angularSpeedSquared;
+	double positionLimitSquared;
+	double rotationLimitSquared;
+	int64_t heartbeatNs;
+
+	bool within(const KeyFrame& anchor, const KeyFrame& frame) const;
+public:
+	explicit MotionGate(const MotionGateOptions& options = MotionGateOptions());
+
+	bool enabled() const {
+		return options.enabled();
+	}
+	// Whether the velocities the runtime reported with a pose are below both speeds, angular velocity in radians per second
+	bool isStill(const vr::HmdVector3_t& velocity, const vr::HmdVector3_t& angularVelocity) const;
+
+	// Decides about the next sample of a device: writes the samples to store, oldest first, into kept and returns
+	// how many there are, none to two. Samples of a device have to come in time order.
+	int pass(uint32_t devId, const KeyFrame& frame, bool still, KeyFrame* kept);
+	// The sample held back at the end of the take, false if there is none
+	bool flush(uint32_t devId, KeyFrame& frame);
+
+	// Samples that were dropped
+	long long gatedCount(uint32_t devId) const {
+		return devId < vr::k_unMaxTrackedDeviceCount ? devices[devId].gated : 0;
+	}
+	const MotionGateOptions& getOptions() const {
+		return options;
+	}
+};
@@ -0,0 +1,53 @@
+#include "PreRoll.h"
+
+#include <algorithm>
+
+PreRollBuffer::PreRollBuffer(size_t devices, size_t samplesPerDevice) : capacity(std::max<size_t>(samplesPerDevice, 1)) {
+	devices = std::max<size_t>(devices, 1);
+	frames.assign(devices * capacity, KeyFrame(0, {}, {}));
+	slotDevice.assign(devices, 0);
+	heads.assign(devices, 0);
+	counts.assign(devices, 0);
+	std::fill(slotOf, slotOf + vr::k_unMaxTrackedDeviceCount, -1);
+}
+
+bool PreRollBuffer::push(uint32_t devId, const KeyFrame& frame) {
+	if (devId >= vr::k_unMaxTrackedDeviceCount) {
+		return false;
+	}
+	int slot = slotOf[devId];
+	if (slot < 0) {
+		if (usedSlots == slotDevice.size()) {
+			return false;
+		}
+		slot = (int)usedSlots++;
+		slotOf[devId] = slot;
+		slotDevice[slot] = devId;
+	}
+	frames[slot * capacity + heads[slot]] = frame;
+	heads[slot] = (heads[slot] + 1) % capacity;
+	counts[slot] = std::min(counts[slot] + 1, capacity);
+	return true;
+}
+
+void PreRollBuffer::drain(int64_t from, const std::function<void(uint32_t devId, const KeyFrame& frame)>& f) {
+	for (size_t slot = 0; slot < usedSlots; slot++) {
+		//the oldest frame sits where the next one would go once the ring is full
+		size_t first = (heads[slot] + capacity - counts[slot]) % capacity;
+		for (size_t i = 0; i < counts[slot]; i++) {
+			auto& frame = frames[slot * capacity + (first + i) % capacity];
+			if (frame.time >= from) {
+				f(slotDevice[slot], frame);
+			}
+		}
+		heads[slot] = counts[slot] = 0;
+	}
+}
+
+size_t PreRollBuffer::size() const {
+	size_t total = 0;
+	for (size_t slot = 0; slot < usedSlots; slot++) {
+		total += counts[slot];
+	}
+	return total;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <openvr.h>
+
+#include "SampleStore.h"
+
+/*
+The last samples of every device in rings of KeyFrames that are allocated once up front, so a recorder
+can keep the last seconds of motion around for hours without allocating. A full ring overwrites its oldest frame.
+Each device gets a slot on its first frame, in the order they come in; once all slots are taken, push() turns
+the frames of further devices away, so they have no pre-roll.
+*/
+class PreRollBuffer {
+private:
+	size_t capacity;
+	std::vector<KeyFrame> frames;
+	// per slot: the device, where its next frame goes and how many frames it holds
+	std::vector<uint32_t> slotDevice;
+	std::vector<size_t> heads;
+	std::vector<size_t> counts;
+	int slotOf[vr::k_unMaxTrackedDeviceCount];
+	size_t usedSlots = 0;
+public:
+	// Takes devices x samplesPerDevice frames of memory
+	PreRollBuffer(size_t devices, size_t samplesPerDevice);
+
+	// False if the device has no slot and none is left
+	bool push(uint32_t devId, const KeyFrame& frame);
+	// Hands every frame at or after from to f, oldest first device by device, and empties the buffer
+	void drain(int64_t from, const std::function<void(uint32_t devId, const KeyFrame& frame)>& f);
+
+	size_t size() const;
+	size_t bytes() const {
+		return frames.capacity() * sizeof(KeyFrame);
+	}
+};
@@ -3,12 +3,26 @@
 #include <vector>
 #include <algorithm>
 #include <iostream>
-#include <conio.h>
+#include <cstdio>
 
+#include "Benchmark.h"
+#include "Capture.h"
+#include "Export.h"
 #include "FbxExport.h"
+#include "FbxBinary.h"
+#include "Journal.h"
+#include "MockVR.h"
+#include "ExportQueue.h"
+#include "Recorder.h"
+#include "ReplayVR.h"
+#include "Scheduler.h"
+#include "StatusDisplay.h"
+#include "TakeFile.h"
 #include "VR.h"
-#include "StopWatch.h"
 #include "Console.h"
+#include "DeviceRegistry.h"
+#include "ControlServer.h"
+#include "Daemon.h"
 
 //for sleeping
 #include <chrono>
@@ -31,8 +45,186 @@ struct Args {
 public:
 	std::string filename;
 	std::vector<int> deviceList;
+	RecorderOptions recorder;
+	std::string journalFile;
+	bool journal = true;
+	std::string recoverFile;
+	std::string exportFile;
+	ExportOptions exportOptions;
+	// several takes in a row on one VR connection, exported in the background
+	bool session = false;
+	size_t sessionExports = 2;
+	// controlled through a local port instead of the keyboard
+	bool daemon = false;
+	uint16_t daemonPort = 7420;
+	// records from a mock runtime or a replayed take instead of SteamVR
+	bool mock = false;
+	std::string replayFile;
+	MockOptions mockOptions;
+	// of the process when parseArgs already did all there was to do, non-zero when a check failed
+	int exitCode = 0;
 };
 
+/*
+Rebuilding a take from the journal of a recording that did not finish and exporting it
+*/
+void recoverTake(const Args& args) {
+	SampleStore samples;
+	std::vector<RecordedDevice> devices;
+	bool gated = false;
+	size_t recovered = Journal::recover(args.recoverFile, samples, devices, &gated);
+	std::cout << "Recovered " << recovered << " samples of " << devices.size() << " devices from " << args.recoverFile << "\n";
+	auto options = args.exportOptions;
+	options.linear = options.linear || gated;
+	auto reports = saveTake(args.filename, samples, devices, options);
+	printReports(std::cout, reports);
+	std::cout << "Exported to " << args.filename << "\n";
+}
+
+/*
+Exporting a raw take that was recorded earlier
+*/
+void exportTake(const Args& args) {
+	SampleStore samples;
+	std::vector<RecordedDevice> devices;
+	CaptureStats stats;
+	TakeFileOptions takeOptions;
+	size_t count = readTake(args.exportFile, samples, devices, &stats, &takeOptions);
+	std::cout << "Read " << count << " samples of " << devices.size() << " devices from " << args.exportFile << "\n";
+	if (stats.poseReads.count() > 0) {
+		printCaptureStats(std::cout, stats, devices);
+	}
+	auto options = args.exportOptions;
+	//the header flag also covers a take that was cut off before its gate chunk
+	options.linear = options.linear || takeOptions.gated;
+	for (auto& device : stats.devices) {
+		options.linear = options.linear || device.gated > 0;
+	}
+	auto reports = saveTake(args.filename, samples, devices, options);
+	printReports(std::cout, reports);
+	std::cout << "Exported to " << args.filename << "\n";
+}
+
+/*
+The raw take options of a recording, flagged when the recorder's motion gate thins out its samples
+*/
+TakeFileOptions gatedTakeOptions(const Args& args) {
+	auto options = args.exportOptions.take;
+	options.gated = args.recorder.gate.enabled();
+	return options;
+}
+
+/*
+Starts recording a take of a session into its own files
+*/
+std::unique_ptr<Recorder> startTake(VR& vr, DeviceRegistry& registry, const Args& args, const std::vector<RecordedDevice>& recorded, const std::string& filename) {
+	std::unique_ptr<Recorder> recorder(new Recorder(vr, args.deviceList, args.recorder));
+	recorder->setRegistry(&registry);
+	if (isTakeFile(filename)) {
+		recorder->setTakeWriter(std::unique_ptr<TakeWriter>(new TakeWriter(filename, recorded, gatedTakeOptions(args))));
+	}
+	if (args.journal) {
+		recorder->setJournal(std::unique_ptr<Journal>(new Journal(filename + ".journal", recorded, args.recorder.gate.enabled())));
+	}
+	recorder->start();
+	return recorder;
+}
+
+/*
+Session mode: a key press ends the take and the next one starts right away on the same VR connection,
+while the finished take is exported in the background. q, Esc or Ctrl+C end the session.
+*/
+void recordSession(VR& vr, DeviceRegistry& registry, const Args& args, const std::vector<RecordedDevice>& recorded) {
+	ExportQueue exports(args.exportOptions, args.sessionExports);
+	installSessionHandlers();
+	std::cout << "\nRecording take after take, press any key for the next take, q to stop.\n\n";
+
+	int take = 1;
+	auto filename = takeFileName(args.filename, take);
+	auto recorder = startTake(vr, registry, args, recorded, filename);
+	std::cout << "Take " << take << ": " << filename << "\n";
+	while (true) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		bool last = stopRequested();
+		if (!last && !nextTakeRequested().exchange(false)) {
+			for (auto& message : exports.takeMessages()) {
+				std::cout << message;
+			}
+			continue;
+		}
+
+		//the next take starts before anything is done with the last one
+		recorder->stop();
+		std::unique_ptr<Recorder> finished = std::move(recorder);
+		auto finishedFile = filename;
+		if (!last) {
+			filename = takeFileName(args.filename, ++take);
+			recorder = startTake(vr, registry, args, recorded, filename);
+		}
+
+		auto& scheduler = finished->getScheduler();
+		std::cout << "Recorded " << scheduler.tickCount() << " ticks in " << finished->elapsed() << " ms, "
+			<< scheduler.missedDeadlines() << " missed deadlines, " << finished->ringOverruns() << " overruns\n";
+		printCaptureStats(std::cout, finished->captureStats(), finished->recordedDevices());
+		if (!isTakeFile(finishedFile)) {
+			std::unique_ptr<ExportJob> job(new ExportJob{ finishedFile, args.journal ? finishedFile + ".journal" : "", finished->releaseSamples(), finished->recordedDevices() });
+			finished.reset();
+			//blocks only if too many takes are still exporting, the next take is recording meanwhile
+			exports.submit(std::move(job));
+		} else if (!finished->takeWriterError().empty()) {
+			std::cout << finishedFile << " failed: " << finished->takeWriterError() << (args.journal ? ", the journal is kept" : "") << "\n";
+		} else if (args.journal) {
+			//the take file is complete, the journal is only needed until then
+			std::remove((finishedFile + ".journal").c_str());
+		}
+		if (last) {
+			break;
+		}
+		std::cout << "Take " << take << ": " << filename << "\n";
+	}
+
+	std::cout << "Waiting for " << exports.pending() << " exports...\n";
+	exports.wait();
+	for (auto& message : exports.takeMessages()) {
+		std::cout << message;
+	}
+}
+
+/*
+Daemon mode: the VR connection stays open and takes are started and stopped by commands on a local port,
+until a quit command, Ctrl+C or SIGTERM
+*/
+void runDaemon(VR& vr, DeviceRegistry& registry, const Args& args, const std::vector<RecordedDevice>& recorded) {
+	DaemonOptions options;
+	options.filename = args.filename;
+	options.deviceList = args.deviceList;
+	options.recorder = args.recorder;
+	options.exportOptions = args.exportOptions;
+	options.journal = args.journal;
+	options.exports = args.sessionExports;
+	RecorderDaemon daemon(vr, options, recorded, &registry);
+	ControlServer server(args.daemonPort);
+	installStopHandlers(false);
+	std::cout << "\nListening for commands on 127.0.0.1:" << server.getPort() << " (start, stop, marker, status, devices, quit)\n";
+
+	server.run([&](const std::string& command) {
+		auto reply = daemon.handle(command);
+		std::cout << command << ": " << reply << "\n";
+		for (auto& message : daemon.exportMessages()) {
+			std::cout << message;
+		}
+		if (daemon.quitRequested()) {
+			stopRequested().store(true);
+		}
+		return reply;
+	}, stopRequested());
+	std::cout << "Stopping, waiting for exports...\n";
+	daemon.finish();
+	for (auto& message : daemon.exportMessages()) {
+		std::cout << message;
+	}
+}
+
 /*
 Reading all arguments that have been specified in Visual Studio (Project/Properties/Debugging/CommandArguments) 
 or when calling the .exe manually in CMD
@@ -52,6 +244,51 @@ bool parseArgs(int argc, char* argv[], Args& args) {
 			listDevices(vr);
 			vr.stop();
 			return false;
+		} else if (strArg == "-bench") {
+			double callCostUs = 20;
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				i++;
+				size_t end = 0;
+				try {
+					callCostUs = std::stod(argv[i], &end);
+				} catch (const std::exception&) {
+					end = 0;
+				}
+				if (end == 0 || argv[i][end] != '\0' || !(callCostUs >= 0 && callCostUs < 1e6)) {
+					std::cout << "Invalid call cost: " << argv[i];
+					args.exitCode = 1;
+					return false;
+				}
+			}
+			runCaptureBenchmark(callCostUs);
+			runStorageBenchmark(10, 1000 * 60 * 10);
+			runTakeFileBenchmark(10, 250 * 60 * 10);
+			runFbxBenchmark(10, 250 * 60 * 10);
+			runExportScalingBenchmark(250 * 60 * 5);
+			bool rotationsPassed = runRotationBenchmark(1 << 22);
+			runInstrumentationBenchmark(1 << 24);
+			args.exitCode = rotationsPassed ? 0 : 1;
+			return false;
+		} else if (strArg == "-loadbench") {
+			LoadBenchmarkOptions options;
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				i++;
+				try {
+					options.seconds = std::stod(argv[i]);
+				} catch (std::invalid_argument) {
+					std::cout << "Invalid take length: " << argv[i];
+					return false;
+				}
+			}
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				i++;
+				options.csvFile = argv[i];
+			}
+			runLoadBenchmark(options);
+			return false;
+		} else if (strArg == "-check") {
+			args.exitCode = runDaemonCheck() ? 0 : 1;
+			return false;
 		} else if (strArg == "-o") {
 			i++;
 			if (i >= argc) {
@@ -59,6 +296,233 @@ bool parseArgs(int argc, char* argv[], Args& args) {
 				return false;
 			}
 			args.filename = argv[i];
+		} else if (strArg == "-rate") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing sample rate after -rate";
+				return false;
+			}
+			try {
+				args.recorder.rate = std::stod(argv[i]);
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid sample rate: " << argv[i];
+				return false;
+			}
+		} else if (strArg == "-ring") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing sample count after -ring";
+				return false;
+			}
+			try {
+				args.recorder.ringSize = std::stoul(argv[i]);
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid ring size: " << argv[i];
+				return false;
+			}
+		} else if (strArg == "-expect") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing minutes after -expect";
+				return false;
+			}
+			try {
+				args.recorder.expectedSeconds = std::stod(argv[i]) * 60;
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid take length: " << argv[i];
+				return false;
+			}
+		} else if (strArg == "-hugepages") {
+			args.recorder.hugePages = true;
+		} else if (strArg == "-preroll") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing seconds after -preroll";
+				return false;
+			}
+			try {
+				args.recorder.preRollSeconds = std::stod(argv[i]);
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid pre-roll length: " << argv[i];
+				return false;
+			}
+		} else if (strArg == "-journal") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing filename after -journal";
+				return false;
+			}
+			args.journalFile = argv[i];
+		} else if (strArg == "-nojournal") {
+			args.journal = false;
+		} else if (strArg == "-recover") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing journal filename after -recover";
+				return false;
+			}
+			args.recoverFile = argv[i];
+		} else if (strArg == "-export") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing take filename after -export";
+				return false;
+			}
+			args.exportFile = argv[i];
+		} else if (strArg == "-precision") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing millimeters after -precision";
+				return false;
+			}
+			try {
+				args.exportOptions.take.positionStep = std::stod(argv[i]) / 1000;
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid precision: " << argv[i];
+				return false;
+			}
+		} else if (strArg == "-reduce") {
+			i += 2;
+			if (i >= argc) {
+				std::cout << "Missing millimeters and degrees after -reduce";
+				return false;
+			}
+			try {
+				args.exportOptions.reduce.positionTolerance = std::stod(argv[i - 1]) / 1000;
+				args.exportOptions.reduce.rotationTolerance = std::stod(argv[i]);
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid tolerance: " << argv[i - 1] << " " << argv[i];
+				return false;
+			}
+		} else if (strArg == "-static") {
+			i += 2;
+			if (i >= argc) {
+				std::cout << "Missing millimeters and degrees after -static";
+				return false;
+			}
+			try {
+				args.exportOptions.staticDevices.positionTolerance = std::stod(argv[i - 1]) / 1000;
+				args.exportOptions.staticDevices.rotationTolerance = std::stod(argv[i]);
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid tolerance: " << argv[i - 1] << " " << argv[i];
+				return false;
+			}
+		} else if (strArg == "-gate") {
+			i += 2;
+			if (i >= argc) {
+				std::cout << "Missing millimeters and degrees after -gate";
+				return false;
+			}
+			try {
+				args.recorder.gate.positionTolerance = std::stod(argv[i - 1]) / 1000;
+				args.recorder.gate.rotationTolerance = std::stod(argv[i]);
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid tolerance: " << argv[i - 1] << " " << argv[i];
+				return false;
+			}
+			//the tolerance holds for keys that are interpolated linearly
+			args.exportOptions.linear = true;
+		} else if (strArg == "-fps") {
+			i++;
+			if (i >= argc || !parseFrameRate(argv[i], args.exportOptions.rate)) {
+				std::cout << "Missing or invalid frame rate after -fps";
+				return false;
+			}
+		} else if (strArg == "-native") {
+			args.exportOptions.nativeFbx = true;
+		} else if (strArg == "-compress") {
+			args.exportOptions.nativeFbx = true;
+			args.exportOptions.fbx.compress = true;
+		} else if (strArg == "-session") {
+			args.session = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				i++;
+				try {
+					args.sessionExports = std::max(1ul, std::stoul(argv[i]));
+				} catch (std::invalid_argument) {
+					std::cout << "Invalid export count: " << argv[i];
+					return false;
+				}
+			}
+		} else if (strArg == "-daemon") {
+			args.daemon = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				i++;
+				try {
+					args.daemonPort = (uint16_t)std::stoul(argv[i]);
+				} catch (std::invalid_argument) {
+					std::cout << "Invalid port: " << argv[i];
+					return false;
+				}
+			}
+		} else if (strArg == "-mock") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing device count after -mock";
+				return false;
+			}
+			try {
+				args.mock = true;
+				args.mockOptions.deviceCount = std::stoul(argv[i]);
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid device count: " << argv[i];
+				return false;
+			}
+		} else if (strArg == "-replay") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing take filename after -replay";
+				return false;
+			}
+			args.replayFile = argv[i];
+		} else if (strArg == "-invalid") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing share after -invalid";
+				return false;
+			}
+			try {
+				args.mockOptions.invalidShare = std::stod(argv[i]);
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid share: " << argv[i];
+				return false;
+			}
+		} else if (strArg == "-dropout") {
+			i += 3;
+			if (i >= argc) {
+				std::cout << "Missing device and seconds after -dropout";
+				return false;
+			}
+			try {
+				args.mockOptions.dropouts.push_back({ (uint32_t)std::stoul(argv[i - 2]), std::stod(argv[i - 1]), std::stod(argv[i]) });
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid dropout: " << argv[i - 2] << " " << argv[i - 1] << " " << argv[i];
+				return false;
+			}
+		} else if (strArg == "-hold") {
+			i += 3;
+			if (i >= argc) {
+				std::cout << "Missing device and seconds after -hold";
+				return false;
+			}
+			try {
+				args.mockOptions.holds.push_back({ (uint32_t)std::stoul(argv[i - 2]), std::stod(argv[i - 1]), std::stod(argv[i]) });
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid hold: " << argv[i - 2] << " " << argv[i - 1] << " " << argv[i];
+				return false;
+			}
+		} else if (strArg == "-seed") {
+			i++;
+			if (i >= argc) {
+				std::cout << "Missing number after -seed";
+				return false;
+			}
+			try {
+				args.mockOptions.seed = std::stoul(argv[i]);
+			} catch (std::invalid_argument) {
+				std::cout << "Invalid seed: " << argv[i];
+				return false;
+			}
 		} else if (strArg == "-d") {
 			i++;
 			while (i < argc && argv[i][0] != '-') {
@@ -86,62 +550,67 @@ bool parseArgs(int argc, char* argv[], Args& args) {
 		auto nameOnly = appName.substr(x + 1);
 		std::cout << nameOnly << " -h\n";
 		std::cout << nameOnly << " -list\n";
-		std::cout << nameOnly << " -o filename -d devicelist\n\n";
+		std::cout << nameOnly << " -bench [us]\n";
+		std::cout << nameOnly << " -check\n";
+		std::cout << nameOnly << " -loadbench [seconds] [results.csv]\n";
+		std::cout << nameOnly << " -recover journal -o filename\n";
+		std::cout << nameOnly << " -export take.vtr -o filename\n";
+		std::cout << nameOnly << " -o filename -d devicelist [-rate hz] [-ring samples] [-expect minutes] [-hugepages]\n\n";
 		std::cout << "-list              List all tracked VR devices and their IDs.\n";
-		std::cout << "-o filename        Gives the file name to write the animation data to.\n";
+		std::cout << "-bench [us]        Benchmark the capture loop against a mock runtime (default 20 us per call),\n";
+		std::cout << "                   exits with 1 if the rotation conversion check fails.\n";
+		std::cout << "-check             Runs the daemon's commands against a mock runtime, exits with 1 if a check fails.\n";
+		std::cout << "-loadbench [s] [f] Records and exports synthetic takes of 1 to 64 devices at 250 to 2000 Hz,\n";
+		std::cout << "                   s seconds each (default 2), and writes the results as CSV to f.\n";
+		std::cout << "-o filename        Gives the file name to write the animation data to (.fbx, or .vtr for a raw take).\n";
 		std::cout << "-d devid devid...  Gives all the device ids to record.\n";
+		std::cout << "-rate hz           Samples per second (default 250, 0 = as fast as possible).\n";
+		std::cout << "-ring samples      Samples buffered between capture and storage (default 65536).\n";
+		std::cout << "-expect minutes    Preallocates sample storage for a take of this length.\n";
+		std::cout << "-hugepages         Backs sample storage with large pages if the OS allows it.\n";
+		std::cout << "-preroll seconds   Keeps the last seconds of motion while armed: the first key starts the take\n";
+		std::cout << "                   that many seconds back, the next one stops it. With -daemon, start does.\n";
+		std::cout << "-gate mm deg       Stores only a sample per second of devices that hold still, plus the ones\n";
+		std::cout << "                   where they start moving, so the take stays within these tolerances.\n";
+		std::cout << "-session [n]       Records take after take: a key starts the next take, q ends. Takes are\n";
+		std::cout << "                   exported in the background, at most n at a time (default 2).\n";
+		std::cout << "-daemon [port]     Keeps running and takes start, stop, marker, status, devices and quit\n";
+		std::cout << "                   commands, one per line, on 127.0.0.1:port (default 7420, 0 = any).\n";
+		std::cout << "-mock n            Records n synthetic devices instead of SteamVR. Their time advances by\n";
+		std::cout << "                   one sample per read at the -rate, so every run sees the same poses.\n";
+		std::cout << "-replay take.vtr   Records a raw take played back in a loop instead of SteamVR.\n";
+		std::cout << "-invalid share     With -mock or -replay, reports this share of poses (0..1) as invalid.\n";
+		std::cout << "-dropout dev s1 s2 With -mock or -replay, disconnects a device from second s1 to s2.\n";
+		std::cout << "-hold dev s1 s2    With -mock or -replay, keeps a device still from second s1 to s2.\n";
+		std::cout << "-seed n            Picks a different but repeatable set of invalid poses.\n";
+		std::cout << "-journal file      Crash-safe copy of the take while recording (default: filename.journal).\n";
+		std::cout << "-nojournal         Records without a journal.\n";
+		std::cout << "-recover journal   Exports the take from the journal of a recording that crashed.\n";
+		std::cout << "-export take.vtr   Exports a raw take to the file given with -o.\n";
+		std::cout << "-precision mm      Position precision of raw takes (default 0.01 mm).\n";
+		std::cout << "-reduce mm deg     Drops FBX keys that are within these tolerances of the recording.\n";
+		std::cout << "-static mm deg     Stores devices whose pose varies less than this (standard deviation) over\n";
+		std::cout << "                   the whole take once: as a static FBX node, or as a single raw sample.\n";
+		std::cout << "-fps rate          Resamples FBX curves to a frame rate, e.g. 24, 23.976, 29.97df or 60.\n";
+		std::cout << "-native            Writes FBX with the built-in writer instead of the Autodesk SDK.\n";
+		std::cout << "-compress          Built-in writer with zlib-compressed key arrays.\n";
 	}
 	return true;
 }
 /*
-Reading pose and rotation from a single tracked device and storing it into a frame
-*/
-void trackDevice(VR &vr,  int devId, int time, std::vector<KeyFrame>& frames) {
-	vr::VRControllerState_t state;
-	vr::TrackedDevicePose_t pose;
-	// read device class
-	vr::ETrackedDeviceClass trackedDeviceClass = vr::VRSystem()->GetTrackedDeviceClass(devId);
-	// read all generic trackers and controllers
-	if ((trackedDeviceClass == vr::ETrackedDeviceClass::TrackedDeviceClass_GenericTracker) || (trackedDeviceClass == vr::ETrackedDeviceClass::TrackedDeviceClass_Controller) || (trackedDeviceClass == vr::ETrackedDeviceClass::TrackedDeviceClass_TrackingReference)) {
-		if (vr.getSystem()->GetControllerStateWithPose(vr::TrackingUniverseStanding, devId, &state, sizeof(state), &pose)) {
-			if (pose.bPoseIsValid) {
-				auto pos = getPosition(pose.mDeviceToAbsoluteTracking);
-				auto rot = getRotation(pose.mDeviceToAbsoluteTracking);
-
-				frames.push_back(KeyFrame(time, pos, rot));
-
-				std::cout << pos.v[0] << " " << pos.v[1] << " " << pos.v[2] << "\n";
-				std::cout << rot.x << " " << rot.y << " " << rot.z << " " << rot.w << "\n";
-			}
-			else {
-				std::cout << "Pose is invalid\n\n";
-			}
-		}
-		else {
-			std::cout << "Could not get pose\n\n";
-		}
-	// for the HMD, functions are different
-	} else if (trackedDeviceClass == vr::ETrackedDeviceClass::TrackedDeviceClass_HMD) {
-		vr.getSystem()->GetDeviceToAbsoluteTrackingPose(vr::TrackingUniverseStanding, 0, &pose, 1);
-		if (pose.bPoseIsValid) {
-			auto pos = getPosition(pose.mDeviceToAbsoluteTracking);
-			auto rot = getRotation(pose.mDeviceToAbsoluteTracking);
-
-			frames.push_back(KeyFrame(time, pos, rot));
-
-			std::cout << pos.v[0] << " " << pos.v[1] << " " << pos.v[2] << "\n";
-			std::cout << rot.x << " " << rot.y << " " << rot.z << " " << rot.w << "\n";
-		} else {
-				std::cout << "Pose is invalid\n\n";
-		}
-	}
-}
-/*
 Main function that is running this program
 */
 int main(int argc, char* argv[]) {
 	Args args;
 	if (!parseArgs(argc, argv, args)) {
+		return args.exitCode;
+	}
+	if (!args.recoverFile.empty()) {
+		recoverTake(args);
+		return 0;
+	}
+	if (!args.exportFile.empty()) {
+		exportTake(args);
 		return 0;
 	}
 	std::cout << "https://github.com/Reimajo/ViveTracker-FBX-Recorder" << "\n\n";
@@ -158,14 +627,26 @@ int main(int argc, char* argv[]) {
 	std::cout << "-list              List all tracked VR devices and their IDs.\n";
 	std::cout << "-o filename        Sets the file name to write the animation data to.\n";
 	std::cout << "-d devid devid...  Sets all the device IDs to record.\n";
+	std::cout << "-rate hz           Sets the samples per second (default 250, 0 = as fast as possible).\n";
 	std::cout << "-----------------------------\n\n";
 	std::cout << "Initialising application, please wait...\n";
 	VR vr;
-	vr.init();
+	std::unique_ptr<MockVRSystem> mock;
+	args.mockOptions.rate = args.recorder.rate;
+	if (!args.replayFile.empty()) {
+		mock.reset(new ReplayVRSystem(args.replayFile, args.mockOptions));
+	} else if (args.mock) {
+		mock.reset(new MockVRSystem(args.mockOptions));
+	}
+	if (mock) {
+		vr.attach(mock.get());
+	} else {
+		vr.init();
+	}
 	Console console;
 	//adding a small delay to allow steam to wake up
 	static bool justStarted = true;
-	if (justStarted) {
+	if (justStarted && !mock) {
 		std::this_thread::sleep_for(std::chrono::seconds(1));
 		justStarted = false;
 	}
@@ -182,7 +663,7 @@ int main(int argc, char* argv[]) {
 		vr::VRControllerState_t state;
 		if (vr.getSystem()->GetControllerState(unDevice, &state, sizeof(state)))
 		{
-			vr::ETrackedDeviceClass trackedDeviceClass = vr::VRSystem()->GetTrackedDeviceClass(unDevice);
+			vr::ETrackedDeviceClass trackedDeviceClass = vr.getSystem()->GetTrackedDeviceClass(unDevice);
 			switch (trackedDeviceClass) {
 			case vr::ETrackedDeviceClass::TrackedDeviceClass_HMD:
 				std::cout << "HMD connected on " + std::to_string(unDevice) + "\n";
@@ -199,6 +680,10 @@ int main(int argc, char* argv[]) {
 	//Listing all devices that are currently trackable, including reference points
 	std::map<int, VrDevice> devices = vr.listDevices();
 
+	//the registry keeps recording devices that connect later, all of them or only the ones asked for
+	DeviceRegistry registry(vr, args.deviceList);
+	registry.scan();
+
 	//When user has no index specified when calling the .exe, we will record all devices
 	if (args.deviceList.empty() == true) {
 		std::cout << "\nNo device list specified, recording all devices\n\n";
@@ -216,11 +701,23 @@ int main(int argc, char* argv[]) {
 			std::cout << "Unrecognized device ID: " << devId << " (unsupported device class or no device at this ID)\n";
 		}
 	}
+	//Samples are stored by device index, so IDs the runtime can never have are dropped
+	args.deviceList.erase(std::remove_if(args.deviceList.begin(), args.deviceList.end(), [](int devId) {
+		return devId < 0 || devId >= (int)vr::k_unMaxTrackedDeviceCount;
+	}), args.deviceList.end());
 
 	// Set up the exporter early, to avoid having "file unavailable" errors *after* the recording
-	auto fbx = setupFbx(args.filename.c_str());  
-	//List of all frames
-	std::map<int, std::vector<KeyFrame>> frames;
+	// raw takes are written while recording, FBX is then only an export step
+	bool rawTake = isTakeFile(args.filename);
+	Fbx fbx = {};
+	std::unique_ptr<FbxBinaryWriter> fbxWriter;
+	if (args.session || args.daemon) {
+		//every take of a session has a file of its own, written by the background export
+	} else if (!rawTake && args.exportOptions.nativeFbx) {
+		fbxWriter.reset(new FbxBinaryWriter(args.filename, args.exportOptions.rate, args.exportOptions.fbx));
+	} else if (!rawTake) {
+		fbx = setupFbx(args.filename.c_str(), args.exportOptions.rate);
+	}
 
 	//Printing all devices that will be recorded
 	for (auto devId : args.deviceList) {
@@ -236,37 +733,102 @@ int main(int argc, char* argv[]) {
 			default : std::cout << "Unknown";
 		}
 		std::cout << ")" << "\n";
-		frames.emplace(devId, std::vector<KeyFrame>());
 	}
 
-	StopWatch watch;
-	std::cout << "\n";
+	std::vector<RecordedDevice> recorded;
+	for (int devId : args.deviceList) {
+		recorded.push_back({ (uint32_t)devId, devices[devId].name });
+	}
+	if (args.daemon) {
+		runDaemon(vr, registry, args, recorded);
+		vr.stop();
+		return 0;
+	}
+	if (args.session) {
+		if (args.recorder.preRollSeconds > 0) {
+			//every take starts where the last one ended, there is nothing before it to keep
+			std::cout << "Takes of a session follow each other, -preroll is ignored\n";
+			args.recorder.preRollSeconds = 0;
+		}
+		recordSession(vr, registry, args, recorded);
+		vr.stop();
+		return 0;
+	}
 
-	watch.start();
-	std::cout << "Recording... press any key to stop.\n";
-	std::cout << std::fixed;
+	Recorder recorder(vr, args.deviceList, args.recorder);
+	recorder.setRegistry(&registry);
+	if (rawTake) {
+		recorder.setTakeWriter(std::unique_ptr<TakeWriter>(new TakeWriter(args.filename, recorded, gatedTakeOptions(args))));
+	}
+	if (args.journal) {
+		if (args.journalFile.empty()) {
+			args.journalFile = args.filename + ".journal";
+		}
+		recorder.setJournal(std::unique_ptr<Journal>(new Journal(args.journalFile, recorded, args.recorder.gate.enabled())));
+		std::cout << "Journal: " << args.journalFile << "\n";
+	}
+	bool preRoll = args.recorder.preRollSeconds > 0;
+	if (preRoll) {
+		//a key commits the pre-roll first, so keys are told apart from q and Esc like in a session
+		installSessionHandlers();
+	} else {
+		installStopHandlers(true);
+	}
+	std::cout << "\n";
 
-	int consoleLines = args.deviceList.size() * 2;
-	for (int i = 0; i < consoleLines; i++) {
-		std::cout << "\n";
+	std::vector<std::string> names;
+	for (auto& dev : recorded) {
+		names.push_back(dev.name);
 	}
+	StatusDisplay status(recorder, args.deviceList, names, console);
+	status.setRegistry(&registry);
 
-	do {
-		console.moveCursor(-consoleLines);
+	recorder.start();
+	if (preRoll) {
+		std::cout << "Armed, keeping the last " << args.recorder.preRollSeconds << " s... press any key to record from then, again to stop, q to quit.\n";
+	} else {
+		std::cout << "Recording... press any key to stop.\n";
+	}
+	status.start();
 
-		int time = watch.time();
-		//our loop for the final recording, runs as long as no key is pressed
-		for (int devId : args.deviceList) {
-			trackDevice(vr, devId, time, frames[devId]);
+	//the recording and the display run on their own threads, we only wait for a key press or Ctrl+C
+	while (!stopRequested()) {
+		if (preRoll && nextTakeRequested().exchange(false)) {
+			if (recorder.isCommitted()) {
+				break;
+			}
+			recorder.commit();
 		}
-	} while (!_kbhit());
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	recorder.stop();
+	status.stop();
 	vr.stop();
+	if (!recorder.isCommitted()) {
+		std::cout << "\nStopped while armed, the take is empty\n";
+	}
+	auto& scheduler = recorder.getScheduler();
+	std::cout << "\nRecorded " << scheduler.tickCount() << " ticks in " << recorder.elapsed() << " ms, " << scheduler.missedDeadlines() << " missed deadlines\n";
+	std::cout << "Ring high water " << recorder.ringHighWater() << "/" << recorder.ringCapacity() << " samples, " << recorder.ringOverruns() << " overruns\n";
+	printCaptureStats(std::cout, recorder.captureStats(), recorder.recordedDevices());
+	auto& samples = recorder.getSamples();
+	std::cout << "Stored " << samples.totalSamples() << " samples in " << samples.bytes() / (1 << 20) << " MB" << (samples.getArena().usingHugePages() ? " of large pages" : "") << "\n";
 
 	// Export to FBX
-	for (int devId : args.deviceList) {
-		setTransforms(fbx.scene, devices[devId].name + " - " + std::to_string(devId), frames[devId]);
+	if (!rawTake) {
+		//devices that connected during the take are exported as well
+		recorded = recorder.recordedDevices();
+		auto reports = fbxWriter ? exportNative(*fbxWriter, samples, recorded, args.exportOptions) : exportFbx(fbx, samples, recorded, args.exportOptions);
+		printReports(std::cout, reports);
+	}
+	if (rawTake && !recorder.takeWriterError().empty()) {
+		std::cout << args.filename << " failed: " << recorder.takeWriterError() << (args.journal ? ", recover the take from " + args.journalFile : "") << "\n";
+		return 1;
+	}
+	// the take is safe in the file now, the journal is only needed if we never get here
+	if (args.journal) {
+		std::remove(args.journalFile.c_str());
 	}
-	cleanupFbx(fbx);
 
 }
 
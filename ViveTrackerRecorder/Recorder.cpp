@@ -0,0 +1,371 @@
+#include "Recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+Recorder::Recorder(VR& vr, const std::vector<int>& deviceList, const RecorderOptions& options)
+	: vr(vr), deviceList(deviceList), scheduler(options.rate), ring(options.ringSize), samples(256 << 10, options.hugePages),
+	pollTicks(options.rate > 0 ? std::max(1ll, (long long)(options.rate / 10)) : 1000), capturedTicks(0),
+	commitRequested(false), takeStart(0), gate(options.gate), stopCapture(false), captureDone(false), intervals(vr::k_unMaxTrackedDeviceCount) {
+	for (auto& count : invalidCounts) {
+		count.store(0);
+	}
+	for (auto& count : receivedCounts) {
+		count.store(0);
+	}
+	if (options.expectedSeconds > 0 && options.rate > 0) {
+		samples.reserve(deviceList, (size_t)(options.expectedSeconds * options.rate));
+	}
+	if (options.preRollSeconds > 0) {
+		//the rings are sized from the rate, as fast as possible has no bound
+		if (options.rate <= 0) {
+			throw std::runtime_error("A pre-roll needs a fixed rate");
+		}
+		preRollNs = (int64_t)(options.preRollSeconds * 1e9);
+		//the device list plus the spares for devices a registry picks up while armed, so memory stays seconds x rate x devices
+		size_t slots = std::min<size_t>(deviceList.size() + options.preRollSpareDevices, vr::k_unMaxTrackedDeviceCount);
+		preRoll.reset(new PreRollBuffer(slots, (size_t)std::ceil(options.preRollSeconds * options.rate) + 1));
+	}
+}
+
+Recorder::~Recorder() {
+	stop();
+}
+
+void* Recorder::operator new(size_t size) {
+	void* p = nullptr;
+#ifdef _WIN32
+	p = _aligned_malloc(size, alignof(Recorder));
+#else
+	if (posix_memalign(&p, alignof(Recorder), size) != 0) {
+		p = nullptr;
+	}
+#endif
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void Recorder::operator delete(void* p) {
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+void Recorder::start() {
+	stopCapture = false;
+	captureDone = false;
+	scheduler.start();
+	captureThread = std::thread(&Recorder::captureLoop, this);
+	consumerThread = std::thread(&Recorder::consumeLoop, this);
+}
+
+void Recorder::stop() {
+	stopCapture = true;
+	if (captureThread.joinable()) {
+		captureThread.join();
+	}
+	if (consumerThread.joinable()) {
+		consumerThread.join();
+	}
+}
+
+/*
+The critical path: wait for the tick, read all poses with one call, push them raw
+*/
+void Recorder::captureLoop() {
+	while (scheduler.wait(stopCapture)) {
+		//the sample time is the clock read that ended the wait, so timing the read takes only one read per tick, as before
+		int64_t time = scheduler.tickTime();
+		if (registry) {
+			samplePoses(vr, registry->recordedDevices(), time, ring, invalidCounts);
+		} else {
+			samplePoses(vr, deviceList, time, ring, invalidCounts);
+		}
+		poseReads.record(scheduler.elapsed() - time);
+		capturedTicks.store(capturedTicks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+	captureDone = true;
+}
+
+void Recorder::consumeLoop() {
+	//a crash loses at most this much of the take
+	const auto commitInterval = std::chrono::milliseconds(100);
+	const uint32_t commitSamples = 4096;
+	auto lastCommit = std::chrono::steady_clock::now();
+	//device events are rare, a tracker that connects is recorded within pollTicks; counting capture ticks instead of
+	//wall-clock time ties the polls to the frames of a mock runtime rather than to how busy this thread was
+	long long nextPoll = 0;
+
+	//samples are converted in batches, so the rotations go through the SIMD kernels
+	const size_t batchSize = 1024;
+	std::vector<RawSample> batch(batchSize);
+	std::vector<float> qx(batchSize), qy(batchSize), qz(batchSize), qw(batchSize);
+	SimdLevel simd = detectSimd();
+	while (true) {
+		//read the flag before draining, so nothing pushed before it was set can be left behind
+		bool done = captureDone;
+		if (preRoll && !committed && commitRequested.load(std::memory_order_acquire)) {
+			commitPreRoll();
+		}
+		bool any = false;
+		while (true) {
+			size_t count = 0;
+			while (count < batchSize && ring.pop(batch[count])) {
+				count++;
+			}
+			if (count == 0) {
+				break;
+			}
+			matricesToQuaternions(&batch[0].matrix, count, sizeof(RawSample), qx.data(), qy.data(), qz.data(), qw.data(), simd);
+			for (size_t i = 0; i < count; i++) {
+				vr::HmdQuaternion_t rotation;
+				rotation.x = qx[i];
+				rotation.y = qy[i];
+				rotation.z = qz[i];
+				rotation.w = qw[i];
+				store(batch[i], rotation);
+			}
+			any = true;
+		}
+		if (done) {
+			flushGate();
+		}
+		long long ticks = capturedTicks.load(std::memory_order_relaxed);
+		if (registry && ticks >= nextPoll) {
+			registry->pollEvents();
+			nextPoll = ticks / pollTicks * pollTicks + pollTicks;
+		}
+		if (journal && journal->pending() > 0) {
+			auto now = std::chrono::steady_clock::now();
+			if (done || journal->pending() >= commitSamples || now - lastCommit >= commitInterval) {
+				journal->commit();
+				lastCommit = now;
+			}
+		}
+		if (done) {
+			if (takeWriter) {
+				try {
+					//the capture thread is done, so its histogram can be read here
+					takeWriter->writeStats(captureStats());
+					takeWriter->close();
+				} catch (std::exception& e) {
+					dropTakeWriter(e);
+				}
+			}
+			if (journal) {
+				journal->close();
+			}
+			break;
+		}
+		if (!any) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+void Recorder::store(const RawSample& sample, vr::HmdQuaternion_t rotation) {
+	KeyFrame frame(sample.time, getPosition(sample.matrix), rotation);
+	receivedCounts[sample.devId].store(receivedCounts[sample.devId].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	if (preRoll && !committed) {
+		preRoll->push(sample.devId, frame);
+	} else if (sample.time >= timeOffset) {
+		KeyFrame taken = frame;
+		taken.time -= timeOffset;
+		keep(sample.devId, taken, gate.enabled() && gate.isStill(sample.velocity, sample.angularVelocity));
+	}
+
+	std::lock_guard<std::mutex> lock(latestMutex);
+	auto it = latest.find(sample.devId);
+	if (it == latest.end()) {
+		latest.emplace(sample.devId, frame);
+	} else {
+		it->second = frame;
+	}
+}
+
+/*
+A sample of the take, in take time. The intervals count every sample, the motion gate decides which ones are stored.
+*/
+void Recorder::keep(uint32_t devId, const KeyFrame& frame, bool still) {
+	if (!(stored >> devId & 1)) {
+		addDevice(devId);
+	} else {
+		intervals[devId].record(frame.time - lastTimes[devId]);
+	}
+	lastTimes[devId] = frame.time;
+	if (!gate.enabled()) {
+		put(devId, frame);
+		return;
+	}
+	KeyFrame kept[2] = { frame, frame };
+	int count = gate.pass(devId, frame, still, kept);
+	for (int i = 0; i < count; i++) {
+		put(devId, kept[i]);
+	}
+}
+
+/*
+Stores a sample and hands it to the journal and take writer
+*/
+void Recorder::put(uint32_t devId, const KeyFrame& frame) {
+	samples[devId].push(frame);
+	if (journal) {
+		journal->append(devId, frame);
+	}
+	if (takeWriter) {
+		try {
+			takeWriter->append(devId, frame);
+		} catch (std::exception& e) {
+			dropTakeWriter(e);
+		}
+	}
+}
+
+/*
+A take file that cannot be written is given up, the samples and the journal go on without it
+*/
+void Recorder::dropTakeWriter(const std::exception& error) {
+	takeFileError = error.what();
+	takeWriter.reset();
+}
+
+void Recorder::commit(std::unique_ptr<Journal> journal, std::unique_ptr<TakeWriter> takeWriter) {
+	if (!preRoll || commitRequested) {
+		return;
+	}
+	//published by the release store below, the consumer only touches them after its acquire load
+	commitJournal = std::move(journal);
+	commitTakeWriter = std::move(takeWriter);
+	takeStart = std::max<int64_t>(0, scheduler.elapsed() - preRollNs);
+	commitRequested.store(true, std::memory_order_release);
+}
+
+/*
+Consumer thread: the part of the pre-roll inside the window goes through the normal path, oldest first per device,
+and every sample after it is stored right away
+*/
+void Recorder::commitPreRoll() {
+	committed = true;
+	timeOffset = takeStart;
+	if (commitJournal) {
+		journal = std::move(commitJournal);
+	}
+	if (commitTakeWriter) {
+		takeWriter = std::move(commitTakeWriter);
+	}
+	preRoll->drain(timeOffset, [this](uint32_t devId, const KeyFrame& frame) {
+		KeyFrame taken = frame;
+		taken.time -= timeOffset;
+		//the pre-roll keeps no velocities, so all of it is stored
+		keep(devId, taken, false);
+	});
+}
+
+/*
+The end of the take is a boundary as well: samples a still device held back are stored
+*/
+void Recorder::flushGate() {
+	KeyFrame frame(0, {}, {});
+	for (uint32_t devId = 0; devId < vr::k_unMaxTrackedDeviceCount; devId++) {
+		if ((stored >> devId & 1) && gate.flush(devId, frame)) {
+			put(devId, frame);
+		}
+	}
+}
+
+/*
+First sample of a device: one that connected during the take has to be declared in the files before it
+*/
+void Recorder::addDevice(uint32_t devId) {
+	stored |= 1ull << devId;
+	if (!registry) {
+		return;
+	}
+	auto device = registry->recordedDevice(devId);
+	if (journal) {
+		journal->addDevice(device);
+	}
+	if (takeWriter) {
+		try {
+			takeWriter->addDevice(device);
+		} catch (std::exception& e) {
+			dropTakeWriter(e);
+		}
+	}
+}
+
+CaptureStats Recorder::captureStats() const {
+	CaptureStats stats;
+	stats.rate = scheduler.rate();
+	stats.poseReads = poseReads;
+	for (uint32_t devId = 0; devId < vr::k_unMaxTrackedDeviceCount; devId++) {
+		long long storedSamples = (long long)samples[devId].size();
+		long long invalid = invalidCount(devId);
+		if (storedSamples == 0 && invalid == 0) {
+			continue;
+		}
+		DeviceCaptureStats device;
+		device.id = devId;
+		device.samples = storedSamples;
+		device.invalid = invalid;
+		device.gated = gate.gatedCount(devId);
+		device.intervals = intervals[devId];
+		stats.devices.push_back(device);
+	}
+	return stats;
+}
+
+std::vector<RecordedDevice> Recorder::recordedDevices() const {
+	uint64_t devices = stored;
+	for (int devId : deviceList) {
+		if (devId >= 0 && devId < (int)vr::k_unMaxTrackedDeviceCount) {
+			devices |= 1ull << devId;
+		}
+	}
+	std::vector<RecordedDevice> result;
+	for (uint32_t devId = 0; devId < vr::k_unMaxTrackedDeviceCount; devId++) {
+		if (devices >> devId & 1) {
+			result.push_back(registry ? registry->recordedDevice(devId) : RecordedDevice{ devId, "" });
+		}
+	}
+	return result;
+}
+
+bool Recorder::latestFrame(int devId, KeyFrame& frame) const {
+	std::lock_guard<std::mutex> lock(latestMutex);
+	auto it = latest.find(devId);
+	if (it == latest.end()) {
+		return false;
+	}
+	frame = it->second;
+	return true;
+}
+
+long long Recorder::invalidCount(int devId) const {
+	if (devId < 0 || devId >= (int)vr::k_unMaxTrackedDeviceCount) {
+		return 0;
+	}
+	return invalidCounts[devId].load(std::memory_order_relaxed);
+}
+
+long long Recorder::receivedCount(int devId) const {
+	if (devId < 0 || devId >= (int)vr::k_unMaxTrackedDeviceCount) {
+		return 0;
+	}
+	return receivedCounts[devId].load(std::memory_order_relaxed);
+}
+
+int Recorder::elapsed() {
+	return (int)((scheduler.elapsed() - takeStart.load(std::memory_order_relaxed)) / 1000000);
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <openvr.h>
+
+#include "Capture.h"
+#include "CaptureStats.h"
+#include "DeviceRegistry.h"
+#include "Journal.h"
+#include "MotionGate.h"
+#include "PreRoll.h"
+#include "SampleStore.h"
+#include "Scheduler.h"
+#include "SpscRing.h"
+#include "TakeFile.h"
+#include "VR.h"
+
+struct RecorderOptions {
+public:
+	double rate = 250;
+	size_t ringSize = 1 << 16;
+	// Length of take to preallocate sample storage for, 0 grows on demand
+	double expectedSeconds = 0;
+	bool hugePages = false;
+	// Seconds of motion kept while armed, which commit() makes the start of the take; 0 records from start()
+	double preRollSeconds = 0;
+	// pre-roll slots on top of the device list, for devices that connect while armed; devices beyond them are
+	// recorded from the commit on, without their pre-roll
+	size_t preRollSpareDevices = 4;
+	// thins out the samples of devices that hold still, off by default
+	MotionGateOptions gate;
+};
+
+/*
+Runs a take on two threads: the capture thread only reads poses at the scheduled rate and pushes them
+raw into a ring, the consumer thread converts them to key frames and stores them.
+Nothing the consumer does (allocating, converting) can delay the next pose read.
+*/
+class Recorder {
+private:
+	VR& vr;
+	std::vector<int> deviceList;
+	RateScheduler scheduler;
+	SpscRing<RawSample> ring;
+	SampleStore samples;
+	// consumer thread only once started
+	std::unique_ptr<Journal> journal;
+	std::unique_ptr<TakeWriter> takeWriter;
+	// why the take writer was given up, empty while it works
+	std::string takeFileError;
+	DeviceRegistry* registry = nullptr;
+	// the registry is polled every pollTicks capture ticks; captured ticks are written by the capture thread only
+	long long pollTicks;
+	std::atomic<long long> capturedTicks;
+	// devices that have stored samples, written by the consumer only
+	uint64_t stored = 0;
+
+	// while armed the consumer keeps samples here instead of storing them
+	std::unique_ptr<PreRollBuffer> preRoll;
+	int64_t preRollNs = 0;
+	std::atomic<bool> commitRequested;
+	// set by commit() before commitRequested, taken over by the consumer after it saw the flag
+	std::unique_ptr<Journal> commitJournal;
+	std::unique_ptr<TakeWriter> commitTakeWriter;
+	// take time zero on the scheduler's clock, set by commit()
+	std::atomic<int64_t> takeStart;
+	// consumer thread only: the commit has been applied, and the takeStart it applied
+	bool committed = false;
+	int64_t timeOffset = 0;
+
+	// consumer thread only
+	MotionGate gate;
+
+	std::atomic<bool> stopCapture;
+	std::atomic<bool> captureDone;
+	std::thread captureThread;
+	std::thread consumerThread;
+
+	std::atomic<long long> invalidCounts[vr::k_unMaxTrackedDeviceCount];
+	// samples the consumer took from the ring, pre-roll ones included; written by the consumer only, read by the status display
+	std::atomic<long long> receivedCounts[vr::k_unMaxTrackedDeviceCount];
+
+	// capture thread only, read once it has finished
+	Histogram poseReads;
+	// consumer thread only: time between a device's samples, and the time of its last one
+	std::vector<Histogram> intervals;
+	int64_t lastTimes[vr::k_unMaxTrackedDeviceCount];
+
+	// latest converted frame per device, for showing progress
+	mutable std::mutex latestMutex;
+	std::map<int, KeyFrame> latest;
+
+	void captureLoop();
+	void consumeLoop();
+	void store(const RawSample& sample, vr::HmdQuaternion_t rotation);
+	void keep(uint32_t devId, const KeyFrame& frame, bool still);
+	void put(uint32_t devId, const KeyFrame& frame);
+	void flushGate();
+	void commitPreRoll();
+	void addDevice(uint32_t devId);
+	void dropTakeWriter(const std::exception& error);
+public:
+	Recorder(VR& vr, const std::vector<int>& deviceList, const RecorderOptions& options);
+	~Recorder();
+
+	// The ring's indices are cache line aligned, which plain new only guarantees from C++17 on
+	static void* operator new(size_t size);
+	static void operator delete(void* p);
+
+	// Every stored sample is also appended to the journal, from the consumer thread. Call before start(); with a pre-roll, pass it to commit() instead.
+	void setJournal(std::unique_ptr<Journal> journal) {
+		this->journal = std::move(journal);
+	}
+
+	// Every stored sample is also encoded into the take file, from the consumer thread. Call before start(); with a pre-roll, pass it to commit() instead.
+	void setTakeWriter(std::unique_ptr<TakeWriter> takeWriter) {
+		this->takeWriter = std::move(takeWriter);
+	}
+
+	// Records the registry's devices instead of the fixed device list, including devices that connect during the take.
+	// The consumer thread applies the runtime's device events, every tenth of a second of capture ticks. Call before start().
+	void setRegistry(DeviceRegistry* registry) {
+		this->registry = registry;
+	}
+
+	void start();
+	// Stops capturing and waits until everything in the ring has been stored
+	void stop();
+
+	// With a pre-roll the recorder starts armed: it captures, but only keeps the last preRollSeconds.
+	// commit() turns them into the start of the take, followed by everything captured from then on.
+	// A journal and a take writer given here get every sample of the take from the pre-roll on; they are handed to
+	// the consumer thread along with the commit, as it is already running. Does nothing without a pre-roll.
+	void commit(std::unique_ptr<Journal> journal = nullptr, std::unique_ptr<TakeWriter> takeWriter = nullptr);
+	// False while armed
+	bool isCommitted() const {
+		return !preRoll || commitRequested.load();
+	}
+	double preRollSeconds() const {
+		return preRollNs / 1e9;
+	}
+
+	// Only valid after stop()
+	SampleStore& getSamples() {
+		return samples;
+	}
+	// Hands the samples over, e.g. to a background export. Only valid after stop(), the recorder is empty afterwards.
+	SampleStore releaseSamples() {
+		return std::move(samples);
+	}
+
+	// Why the take writer failed, empty if it wrote the whole take or there was none. Only valid after stop().
+	const std::string& takeWriterError() const {
+		return takeFileError;
+	}
+
+	// Pose read times, per device sample intervals and samples the gate dropped. Only valid after stop(); with a take writer they are also written into the take.
+	CaptureStats captureStats() const;
+
+	// The devices of the take: the device list and everything that was stored. Names come from the registry, so only with one.
+	std::vector<RecordedDevice> recordedDevices() const;
+
+	bool latestFrame(int devId, KeyFrame& frame) const;
+	long long invalidCount(int devId) const;
+	long long receivedCount(int devId) const;
+	// milliseconds of take time: since start(), or since the start of the pre-roll once committed
+	int elapsed();
+
+	size_t ringOccupancy() const {
+		return ring.size();
+	}
+	size_t ringHighWater() const {
+		return ring.highWaterMark();
+	}
+	size_t ringCapacity() const {
+		return ring.capacity();
+	}
+	long long ringOverruns() const {
+		return ring.overrunCount();
+	}
+	const RateScheduler& getScheduler() const {
+		return scheduler;
+	}
+};
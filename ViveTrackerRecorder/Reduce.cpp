@@ -0,0 +1,119 @@
+#include "Reduce.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <utility>
+
+double reduceChannel(Channel& channel, double tolerance) {
+	size_t count = channel.size();
+	if (count <= 2 || tolerance <= 0) {
+		return 0;
+	}
+	auto& time = channel.time;
+	auto& value = channel.value;
+
+	// an explicit stack instead of recursion, takes have millions of samples
+	std::vector<char> keep(count, 0);
+	keep[0] = keep[count - 1] = 1;
+	std::vector<std::pair<size_t, size_t>> segments;
+	segments.push_back({ 0, count - 1 });
+	double maxError = 0;
+
+	while (!segments.empty()) {
+		auto first = segments.back().first;
+		auto last = segments.back().second;
+		segments.pop_back();
+		if (last - first < 2) {
+			continue;
+		}
+
+		double t0 = time[first];
+		double v0 = value[first];
+		double dt = (double)time[last] - t0;
+		double slope = dt > 0 ? (value[last] - v0) / dt : 0;
+
+		size_t worst = first;
+		double worstError = -1;
+		for (size_t i = first + 1; i < last; i++) {
+			double error = std::abs(value[i] - (v0 + (time[i] - t0) * slope));
+			if (error > worstError) {
+				worstError = error;
+				worst = i;
+			}
+		}
+
+		if (worstError > tolerance) {
+			keep[worst] = 1;
+			segments.push_back({ first, worst });
+			segments.push_back({ worst, last });
+		} else {
+			maxError = std::max(maxError, worstError);
+		}
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (keep[i]) {
+			time[kept] = time[i];
+			value[kept] = value[i];
+			kept++;
+		}
+	}
+	time.resize(kept);
+	value.resize(kept);
+	time.shrink_to_fit();
+	value.shrink_to_fit();
+	return maxError;
+}
+
+std::vector<ReduceReport> reduceCurves(std::vector<DeviceCurves>& curves, const ReduceOptions& options, ThreadPool& pool) {
+	std::vector<ReduceReport> reports(curves.size());
+	std::vector<std::future<double>> errors;
+	for (size_t d = 0; d < curves.size(); d++) {
+		reports[d].name = curves[d].name;
+		reports[d].keysBefore = curves[d].keyCount();
+		reports[d].keysAfter = curves[d].keyCount();
+		if (curves[d].isStatic) {
+			continue;
+		}
+		curves[d].linear = true;
+		for (int c = 0; c < DeviceCurves::COUNT; c++) {
+			auto channel = &curves[d].channels[c];
+			double tolerance = c < DeviceCurves::RX ? options.positionTolerance : options.rotationTolerance;
+			errors.push_back(pool.submit([channel, tolerance]() { return reduceChannel(*channel, tolerance); }));
+		}
+	}
+
+	size_t next = 0;
+	for (size_t d = 0; d < curves.size(); d++) {
+		if (curves[d].isStatic) {
+			continue;
+		}
+		for (int c = 0; c < DeviceCurves::COUNT; c++) {
+			double error = errors[next++].get();
+			if (c < DeviceCurves::RX) {
+				reports[d].maxPositionError = std::max(reports[d].maxPositionError, error);
+			} else {
+				reports[d].maxRotationError = std::max(reports[d].maxRotationError, error);
+			}
+		}
+		reports[d].keysAfter = curves[d].keyCount();
+	}
+	return reports;
+}
+
+void printReports(std::ostream& out, const std::vector<ReduceReport>& reports) {
+	for (auto& report : reports) {
+		if (report.isStatic) {
+			out << report.name << ": static, " << report.keysBefore << " keys -> node transform, max error "
+				<< report.maxPositionError * 1000 << " mm, " << report.maxRotationError << " deg\n";
+			continue;
+		}
+		out << report.name << ": " << report.keysBefore << " -> " << report.keysAfter << " keys";
+		if (report.keysAfter > 0) {
+			out << " (" << report.keysBefore / report.keysAfter << "x fewer)";
+		}
+		out << ", max error " << report.maxPositionError * 1000 << " mm, " << report.maxRotationError << " deg\n";
+	}
+}
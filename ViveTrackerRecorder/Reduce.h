@@ -0,0 +1,48 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Curves.h"
+#include "ThreadPool.h"
+
+/*
+How far a reduced curve may stray from the recorded samples, per channel.
+A tolerance of 0 keeps every key of that kind of channel.
+*/
+struct ReduceOptions {
+public:
+	double positionTolerance = 0; // meters
+	double rotationTolerance = 0; // degrees
+
+	bool enabled() const {
+		return positionTolerance > 0 || rotationTolerance > 0;
+	}
+};
+
+struct ReduceReport {
+public:
+	std::string name;
+	size_t keysBefore = 0;
+	size_t keysAfter = 0;
+	double maxPositionError = 0; // meters
+	double maxRotationError = 0; // degrees
+	// stored once as the transform of its node, all keys were dropped
+	bool isStatic = false;
+};
+
+/*
+Drops the keys of a channel that linear interpolation between the remaining keys reproduces
+within the tolerance (Ramer-Douglas-Peucker, measured along the value axis).
+Returns the largest error of any dropped key.
+*/
+double reduceChannel(Channel& channel, double tolerance);
+
+/*
+Reduces every channel of every device, one pool job per channel.
+The curves are switched to linear interpolation, which is what the error bound assumes. Static curves are left as they are.
+*/
+std::vector<ReduceReport> reduceCurves(std::vector<DeviceCurves>& curves, const ReduceOptions& options, ThreadPool& pool);
+
+void printReports(std::ostream& out, const std::vector<ReduceReport>& reports);
@@ -0,0 +1,101 @@
+#include "ReplayVR.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "TakeFile.h"
+
+/*
+Pose matrix of a recorded position and rotation, the rotation is normalized again after quantization
+*/
+static vr::HmdMatrix34_t toMatrix(const KeyFrame& frame) {
+	double x = frame.rotation.x, y = frame.rotation.y, z = frame.rotation.z, w = frame.rotation.w;
+	double n = std::sqrt(x * x + y * y + z * z + w * w);
+	if (n > 0) {
+		x /= n; y /= n; z /= n; w /= n;
+	}
+	vr::HmdMatrix34_t m;
+	m.m[0][0] = (float)(1 - 2 * (y * y + z * z)); m.m[0][1] = (float)(2 * (x * y - z * w)); m.m[0][2] = (float)(2 * (x * z + y * w));
+	m.m[1][0] = (float)(2 * (x * y + z * w)); m.m[1][1] = (float)(1 - 2 * (x * x + z * z)); m.m[1][2] = (float)(2 * (y * z - x * w));
+	m.m[2][0] = (float)(2 * (x * z - y * w)); m.m[2][1] = (float)(2 * (y * z + x * w)); m.m[2][2] = (float)(1 - 2 * (x * x + y * y));
+	m.m[0][3] = frame.position.v[0];
+	m.m[1][3] = frame.position.v[1];
+	m.m[2][3] = frame.position.v[2];
+	return m;
+}
+
+ReplayVRSystem::ReplayVRSystem(const std::string& takeFile, const MockOptions& options) : MockVRSystem(options) {
+	readTake(takeFile, samples, devices);
+	names.resize(vr::k_unMaxTrackedDeviceCount);
+	int64_t lastTime = 0;
+	size_t longest = 0;
+	bool any = false;
+	for (auto& dev : devices) {
+		auto& track = samples[dev.id];
+		if (track.empty()) {
+			continue;
+		}
+		names[dev.id] = dev.name;
+		firstTime = any ? std::min(firstTime, track.time[0]) : track.time[0];
+		lastTime = any ? std::max(lastTime, track.time.back()) : track.time.back();
+		longest = std::max(longest, track.size());
+		any = true;
+	}
+	if (!any) {
+		throw std::runtime_error("No samples to replay in " + takeFile);
+	}
+	int64_t interval = longest > 1 ? std::max<int64_t>(1, (lastTime - firstTime) / (int64_t)(longest - 1)) : 1;
+	loopLength = lastTime - firstTime + interval;
+}
+
+bool ReplayVRSystem::hasDevice(vr::TrackedDeviceIndex_t unDeviceIndex) const {
+	return unDeviceIndex < names.size() && !names[unDeviceIndex].empty();
+}
+
+std::string ReplayVRSystem::modelName(vr::TrackedDeviceIndex_t unDeviceIndex) const {
+	return names[unDeviceIndex];
+}
+
+/*
+The last recorded sample at or before the take time; before its first sample a device has no pose, as in the recording
+*/
+bool ReplayVRSystem::fillPose(vr::TrackedDeviceIndex_t unDeviceIndex, double t, vr::TrackedDevicePose_t* pose) {
+	auto& track = samples[unDeviceIndex];
+	int64_t ns = (int64_t)std::floor(t * 1e9);
+	int64_t time = firstTime + ((ns % loopLength) + loopLength) % loopLength;
+	//binary search, no state, so reads from several threads are fine
+	size_t lo = 0, hi = track.size();
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (track.time[mid] <= time) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo == 0) {
+		return false;
+	}
+	auto from = track.frame(lo - 1);
+	pose->mDeviceToAbsoluteTracking = toMatrix(from);
+	//the take has no velocities, the ones towards the next sample stand in for them
+	if (lo < track.size() && track.time[lo] > from.time) {
+		auto to = track.frame(lo);
+		double seconds = (to.time - from.time) / 1e9;
+		for (int c = 0; c < 3; c++) {
+			pose->vVelocity.v[c] = (float)((to.position.v[c] - from.position.v[c]) / seconds);
+		}
+		//the vector part of to * conjugate(from) is half the turn angle along its axis, for small turns
+		auto& a = from.rotation;
+		auto& b = to.rotation;
+		double sign = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z < 0 ? -1 : 1;
+		double x = b.x * a.w - b.w * a.x - b.y * a.z + b.z * a.y;
+		double y = b.y * a.w - b.w * a.y - b.z * a.x + b.x * a.z;
+		double z = b.z * a.w - b.w * a.z - b.x * a.y + b.y * a.x;
+		pose->vAngularVelocity.v[0] = (float)(2 * sign * x / seconds);
+		pose->vAngularVelocity.v[1] = (float)(2 * sign * y / seconds);
+		pose->vAngularVelocity.v[2] = (float)(2 * sign * z / seconds);
+	}
+	return true;
+}
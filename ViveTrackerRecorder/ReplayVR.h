@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "MockVR.h"
+#include "SampleStore.h"
+
+/*
+Plays a raw take (.vtr) back through the IVRSystem interface, so the recorder can run on recorded motion without a headset.
+Every device keeps the id and name it was recorded with and reports the recorded pose that was current at the mock's time.
+The take loops, so a run can be longer than the recording. Invalid poses and dropouts from the options come on top.
+*/
+class ReplayVRSystem : public MockVRSystem {
+private:
+	SampleStore samples;
+	std::vector<RecordedDevice> devices;
+	// by device index, empty for indices that are not in the take
+	std::vector<std::string> names;
+	int64_t firstTime = 0;
+	// ns until the take starts over, one sample interval longer than the take
+	int64_t loopLength = 1;
+protected:
+	virtual bool hasDevice(vr::TrackedDeviceIndex_t unDeviceIndex) const override;
+	virtual std::string modelName(vr::TrackedDeviceIndex_t unDeviceIndex) const override;
+	virtual bool fillPose(vr::TrackedDeviceIndex_t unDeviceIndex, double t, vr::TrackedDevicePose_t* pose) override;
+public:
+	// Reads the whole take, options.deviceCount is ignored
+	ReplayVRSystem(const std::string& takeFile, const MockOptions& options);
+
+	const std::vector<RecordedDevice>& getDevices() const {
+		return devices;
+	}
+};
@@ -0,0 +1,140 @@
+#include "Resample.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+bool parseFrameRate(const std::string& text, FrameRate& rate) {
+	auto number = text;
+	rate = FrameRate();
+	for (auto suffix : { "df", "drop" }) {
+		auto length = std::string(suffix).size();
+		if (number.size() > length && number.substr(number.size() - length) == suffix) {
+			number = number.substr(0, number.size() - length);
+			rate.dropFrame = true;
+		}
+	}
+
+	double fps;
+	size_t end = 0;
+	try {
+		fps = std::stod(number, &end);
+	} catch (const std::exception&) {
+		//out_of_range too, for something like 1e999
+		return false;
+	}
+	//all of it a number, and small enough that fps * 1000 fits the numerator
+	if (end != number.size() || !(fps > 0 && fps <= 1000000)) {
+		return false;
+	}
+
+	//the NTSC family runs 1000/1001 slower than the rate it is named after
+	double nominal = std::round(fps);
+	if (std::abs(fps - nominal) < 0.001) {
+		rate.numerator = (int)nominal;
+		rate.denominator = 1;
+	} else if (std::abs(fps - nominal * 1000 / 1001) < 0.01) {
+		rate.numerator = (int)nominal * 1000;
+		rate.denominator = 1001;
+	} else {
+		rate.numerator = (int)std::round(fps * 1000);
+		rate.denominator = 1000;
+	}
+	//drop frame timecode only exists for the NTSC rates
+	if (rate.denominator != 1001) {
+		rate.dropFrame = false;
+	}
+	return true;
+}
+
+static vr::HmdQuaternion_t slerp(vr::HmdQuaternion_t a, vr::HmdQuaternion_t b, double t) {
+	double dot = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+	//q and -q are the same rotation, take the short way round
+	if (dot < 0) {
+		dot = -dot;
+		b.w = -b.w;
+		b.x = -b.x;
+		b.y = -b.y;
+		b.z = -b.z;
+	}
+	double wa, wb;
+	if (dot > 0.9995) {
+		//nearly the same rotation, sin() would divide by almost zero
+		wa = 1 - t;
+		wb = t;
+	} else {
+		double angle = std::acos(dot);
+		double sinAngle = std::sin(angle);
+		wa = std::sin((1 - t) * angle) / sinAngle;
+		wb = std::sin(t * angle) / sinAngle;
+	}
+	vr::HmdQuaternion_t q;
+	q.w = wa * a.w + wb * b.w;
+	q.x = wa * a.x + wb * b.x;
+	q.y = wa * a.y + wb * b.y;
+	q.z = wa * a.z + wb * b.z;
+	double length = std::sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+	q.w /= length;
+	q.x /= length;
+	q.y /= length;
+	q.z /= length;
+	return q;
+}
+
+DeviceCurves resampleCurves(const std::string& objName, const DeviceTrack& track, const FrameRate& rate) {
+	DeviceCurves curves;
+	curves.name = objName;
+	curves.rate = rate;
+	if (track.empty()) {
+		return curves;
+	}
+
+	//only frames that lie between two samples, nothing is extrapolated
+	auto firstFrame = (long long)std::ceil(track.time[0] * rate.fps() / 1e9 - 1e-9);
+	auto lastFrame = (long long)std::floor(track.time[track.size() - 1] * rate.fps() / 1e9 + 1e-9);
+	if (lastFrame < firstFrame) {
+		return curves;
+	}
+	size_t frames = (size_t)(lastFrame - firstFrame + 1);
+	for (auto& channel : curves.channels) {
+		channel.time.resize(frames);
+		channel.value.resize(frames);
+	}
+
+	//the interpolated rotations are converted to Euler angles in one batch at the end
+	std::vector<float> qx(frames), qy(frames), qz(frames), qw(frames);
+	size_t next = 0;
+	for (size_t f = 0; f < frames; f++) {
+		long long frame = firstFrame + (long long)f;
+		double time = rate.frameTime(frame);
+		//samples and frames both move forward, so the pair around each frame is found in one pass
+		while (next < track.size() && track.time[next] < time) {
+			next++;
+		}
+		size_t b = next < track.size() ? next : track.size() - 1;
+		size_t a = b > 0 ? b - 1 : 0;
+		double span = (double)track.time[b] - track.time[a];
+		double t = span > 0 ? (time - track.time[a]) / span : 0;
+		t = std::max(0.0, std::min(1.0, t));
+
+		auto from = track.frame(a);
+		auto to = track.frame(b);
+		auto rotation = slerp(from.rotation, to.rotation, t);
+		qx[f] = (float)rotation.x;
+		qy[f] = (float)rotation.y;
+		qz[f] = (float)rotation.z;
+		qw[f] = (float)rotation.w;
+
+		for (auto& channel : curves.channels) {
+			channel.time[f] = frame;
+		}
+		curves.channels[DeviceCurves::TX].value[f] = (float)(from.position.v[0] + (to.position.v[0] - from.position.v[0]) * t);
+		curves.channels[DeviceCurves::TY].value[f] = (float)(from.position.v[1] + (to.position.v[1] - from.position.v[1]) * t);
+		curves.channels[DeviceCurves::TZ].value[f] = (float)(from.position.v[2] + (to.position.v[2] - from.position.v[2]) * t);
+	}
+	quaternionsToEuler(qx.data(), qy.data(), qz.data(), qw.data(), frames,
+		&curves.channels[DeviceCurves::RX].value[0], &curves.channels[DeviceCurves::RY].value[0], &curves.channels[DeviceCurves::RZ].value[0]);
+	unwrapEuler(&curves.channels[DeviceCurves::RX].value[0], &curves.channels[DeviceCurves::RY].value[0], &curves.channels[DeviceCurves::RZ].value[0], frames);
+	return curves;
+}
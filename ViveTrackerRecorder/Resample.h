@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+#include "Curves.h"
+#include "SampleStore.h"
+
+/*
+Reads a frame rate from the command line: 23.976, 24, 25, 29.97, 29.97df, 30, 47.952, 48, 50,
+59.94, 59.94df, 60, 119.88, 120 or any other number of frames per second
+*/
+bool parseFrameRate(const std::string& text, FrameRate& rate);
+
+/*
+Interpolates a recorded track onto the frames of a fixed rate: positions linearly, rotations by slerp.
+Frame n is at n / fps seconds after the recording started, so all devices share the same frames.
+The channel times of the result are frame numbers.
+*/
+DeviceCurves resampleCurves(const std::string& objName, const DeviceTrack& track, const FrameRate& rate);
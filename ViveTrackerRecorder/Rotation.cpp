@@ -0,0 +1,226 @@
+#include "Rotation.h"
+
+#include <cmath>
+
+#include "RotationKernels.h"
+
+#ifdef ROTATION_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+static const double pi = 3.14159265358979323846;
+
+vr::HmdQuaternion_t getRotation(vr::HmdMatrix34_t matrix) {
+	vr::HmdQuaternion_t q;
+	//change for V1.1: casting all float values to double
+	q.w = sqrt(fmax(0, 1 + (double) matrix.m[0][0] + (double) matrix.m[1][1] + (double) matrix.m[2][2])) / 2;
+	q.x = sqrt(fmax(0, 1 + (double)matrix.m[0][0] - (double) matrix.m[1][1] - (double) matrix.m[2][2])) / 2;
+	q.y = sqrt(fmax(0, 1 - (double)matrix.m[0][0] + (double) matrix.m[1][1] - (double) matrix.m[2][2])) / 2;
+	q.z = sqrt(fmax(0, 1 - (double)matrix.m[0][0] - (double) matrix.m[1][1] + (double) matrix.m[2][2])) / 2;
+	q.x = copysign(q.x, (double) matrix.m[2][1] - (double) matrix.m[1][2]);
+	q.y = copysign(q.y, (double) matrix.m[0][2] - (double) matrix.m[2][0]);
+	q.z = copysign(q.z, (double) matrix.m[1][0] - (double) matrix.m[0][1]);
+	return q;
+}
+
+vr::HmdVector3_t getPosition(vr::HmdMatrix34_t matrix) {
+	vr::HmdVector3_t vector;
+
+	vector.v[0] = matrix.m[0][3];
+	vector.v[1] = matrix.m[1][3];
+	vector.v[2] = matrix.m[2][3];
+
+	return vector;
+}
+
+vr::HmdVector3_t toEulerAngles(vr::HmdQuaternion_t q) {
+	vr::HmdVector3_t angles;
+
+	// roll (x-axis rotation)
+	double sinr_cosp = 2 * (q.w * q.x + q.y * q.z);
+	double cosr_cosp = 1 - 2 * (q.x * q.x + q.y * q.y);
+	angles.v[0] = std::atan2(sinr_cosp, cosr_cosp);
+
+	// pitch (y-axis rotation), atan2 against cos(pitch) instead of asin, which loses precision near 90 degrees
+	// and needs a normalized quaternion
+	double sinp = 2 * (q.w * q.y - q.z * q.x);
+	angles.v[1] = std::atan2(sinp, std::sqrt(sinr_cosp * sinr_cosp + cosr_cosp * cosr_cosp));
+
+	// yaw (z-axis rotation)
+	double siny_cosp = 2 * (q.w * q.z + q.x * q.y);
+	double cosy_cosp = 1 - 2 * (q.y * q.y + q.z * q.z);
+	angles.v[2] = std::atan2(siny_cosp, cosy_cosp);
+
+	for (int i = 0; i <= 2; i++) {
+		angles.v[i] *= 180 / pi;
+	}
+
+	return angles;
+}
+
+SimdLevel detectSimd() {
+#ifdef ROTATION_X86
+	static const SimdLevel level = []() {
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 1);
+		//AVX also needs the OS to save the YMM registers (OSXSAVE and XCR0)
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+			return SimdSSE2;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0 ? SimdAVX2 : SimdSSE2;
+#else
+		return __builtin_cpu_supports("avx2") ? SimdAVX2 : SimdSSE2;
+#endif
+	}();
+	return level;
+#else
+	return SimdScalar;
+#endif
+}
+
+const char* simdName(SimdLevel level) {
+	switch (level) {
+	case SimdAVX2: return "AVX2";
+	case SimdSSE2: return "SSE2";
+	default: return "scalar";
+	}
+}
+
+static size_t toQuaternionsSimd(const vr::HmdMatrix34_t* matrices, size_t count, size_t stride,
+	float* qx, float* qy, float* qz, float* qw, SimdLevel level) {
+#ifdef ROTATION_X86
+	if (level == SimdAVX2) {
+		return toQuaternionsAvx2(matrices, count, stride, qx, qy, qz, qw);
+	} else if (level == SimdSSE2) {
+		return toQuaternionsSse2(matrices, count, stride, qx, qy, qz, qw);
+	}
+#endif
+	return 0;
+}
+
+static size_t toEulerSimd(const float* qx, const float* qy, const float* qz, const float* qw, size_t count,
+	float* rx, float* ry, float* rz, SimdLevel level) {
+#ifdef ROTATION_X86
+	if (level == SimdAVX2) {
+		return toEulerAvx2(qx, qy, qz, qw, count, rx, ry, rz);
+	} else if (level == SimdSSE2) {
+		return toEulerSse2(qx, qy, qz, qw, count, rx, ry, rz);
+	}
+#endif
+	return 0;
+}
+
+//widest vector of any level, the tail of a batch is padded to it
+static const size_t maxWidth = 8;
+
+void matricesToQuaternions(const vr::HmdMatrix34_t* matrices, size_t count, size_t stride,
+	float* qx, float* qy, float* qz, float* qw, SimdLevel level) {
+	size_t done = toQuaternionsSimd(matrices, count, stride, qx, qy, qz, qw, level);
+	const char* base = reinterpret_cast<const char*>(matrices);
+	if (level != SimdScalar && done < count) {
+		//run the tail through the same kernel, so a sample converts the same wherever it is in the batch
+		vr::HmdMatrix34_t tail[maxWidth] = {};
+		float x[maxWidth], y[maxWidth], z[maxWidth], w[maxWidth];
+		size_t rest = count - done;
+		for (size_t i = 0; i < rest; i++) {
+			tail[i] = *reinterpret_cast<const vr::HmdMatrix34_t*>(base + (done + i) * stride);
+		}
+		toQuaternionsSimd(tail, maxWidth, sizeof(vr::HmdMatrix34_t), x, y, z, w, level);
+		for (size_t i = 0; i < rest; i++) {
+			qx[done + i] = x[i];
+			qy[done + i] = y[i];
+			qz[done + i] = z[i];
+			qw[done + i] = w[i];
+		}
+		return;
+	}
+	for (size_t i = done; i < count; i++) {
+		auto q = getRotation(*reinterpret_cast<const vr::HmdMatrix34_t*>(base + i * stride));
+		qx[i] = (float)q.x;
+		qy[i] = (float)q.y;
+		qz[i] = (float)q.z;
+		qw[i] = (float)q.w;
+	}
+}
+
+void quaternionsToEuler(const float* qx, const float* qy, const float* qz, const float* qw, size_t count,
+	float* rx, float* ry, float* rz, SimdLevel level) {
+	size_t done = toEulerSimd(qx, qy, qz, qw, count, rx, ry, rz, level);
+	if (level != SimdScalar && done < count) {
+		float x[maxWidth] = {}, y[maxWidth] = {}, z[maxWidth] = {}, w[maxWidth] = {};
+		float ex[maxWidth], ey[maxWidth], ez[maxWidth];
+		size_t rest = count - done;
+		for (size_t i = 0; i < rest; i++) {
+			x[i] = qx[done + i];
+			y[i] = qy[done + i];
+			z[i] = qz[done + i];
+			w[i] = qw[done + i];
+		}
+		toEulerSimd(x, y, z, w, maxWidth, ex, ey, ez, level);
+		for (size_t i = 0; i < rest; i++) {
+			rx[done + i] = ex[i];
+			ry[done + i] = ey[i];
+			rz[done + i] = ez[i];
+		}
+		return;
+	}
+	for (size_t i = done; i < count; i++) {
+		vr::HmdQuaternion_t q;
+		q.x = qx[i];
+		q.y = qy[i];
+		q.z = qz[i];
+		q.w = qw[i];
+		auto euler = toEulerAngles(q);
+		rx[i] = euler.v[0];
+		ry[i] = euler.v[1];
+		rz[i] = euler.v[2];
+	}
+}
+
+#ifdef ROTATION_X86
+#include <emmintrin.h>
+
+/*
+SSE2 is part of every x64 CPU, so it needs no detection and no special compiler flags
+*/
+struct Sse2 {
+	typedef __m128 Float;
+	enum { width = 4 };
+
+	static Float set(float v) { return _mm_set1_ps(v); }
+	static Float load(const float* p) { return _mm_loadu_ps(p); }
+	static void store(float* p, Float v) { _mm_storeu_ps(p, v); }
+	static Float gather(const char* base, size_t stride, int element) {
+		auto at = [&](int i) { return reinterpret_cast<const float*>(base + i * stride)[element]; };
+		return _mm_set_ps(at(3), at(2), at(1), at(0));
+	}
+	static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+	static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+	static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+	static Float div(Float a, Float b) { return _mm_div_ps(a, b); }
+	static Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+	static Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+	static Float sqrt(Float a) { return _mm_sqrt_ps(a); }
+	static Float andBits(Float a, Float b) { return _mm_and_ps(a, b); }
+	static Float andNotBits(Float a, Float b) { return _mm_andnot_ps(a, b); }
+	static Float orBits(Float a, Float b) { return _mm_or_ps(a, b); }
+	static Float greater(Float a, Float b) { return _mm_cmpgt_ps(a, b); }
+	static Float less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+	static Float select(Float mask, Float a, Float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	static void finish() {}
+};
+
+size_t toQuaternionsSse2(const vr::HmdMatrix34_t* matrices, size_t count, size_t stride, float* qx, float* qy, float* qz, float* qw) {
+	return RotationKernels<Sse2>::toQuaternions(matrices, count, stride, qx, qy, qz, qw);
+}
+
+size_t toEulerSse2(const float* qx, const float* qy, const float* qz, const float* qw, size_t count, float* rx, float* ry, float* rz) {
+	return RotationKernels<Sse2>::toEuler(qx, qy, qz, qw, count, rx, ry, rz);
+}
+#endif
@@ -0,0 +1,47 @@
+//this file is compiled for AVX2 (vcxproj: EnableEnhancedInstructionSet), it only runs after detectSimd() found it
+#if defined(__GNUC__)
+#pragma GCC target("avx2,fma")
+#endif
+
+#include "RotationKernels.h"
+
+#ifdef ROTATION_X86
+#include <immintrin.h>
+
+struct Avx2 {
+	typedef __m256 Float;
+	enum { width = 8 };
+
+	static Float set(float v) { return _mm256_set1_ps(v); }
+	static Float load(const float* p) { return _mm256_loadu_ps(p); }
+	static void store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+	static Float gather(const char* base, size_t stride, int element) {
+		int s = (int)stride;
+		__m256i offsets = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+		return _mm256_i32gather_ps(reinterpret_cast<const float*>(base) + element, offsets, 1);
+	}
+	static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+	static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+	static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	static Float div(Float a, Float b) { return _mm256_div_ps(a, b); }
+	static Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+	static Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+	static Float sqrt(Float a) { return _mm256_sqrt_ps(a); }
+	static Float andBits(Float a, Float b) { return _mm256_and_ps(a, b); }
+	static Float andNotBits(Float a, Float b) { return _mm256_andnot_ps(a, b); }
+	static Float orBits(Float a, Float b) { return _mm256_or_ps(a, b); }
+	static Float greater(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static Float less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static Float select(Float mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+	//leave no dirty upper halves behind for the SSE code around it
+	static void finish() { _mm256_zeroupper(); }
+};
+
+size_t toQuaternionsAvx2(const vr::HmdMatrix34_t* matrices, size_t count, size_t stride, float* qx, float* qy, float* qz, float* qw) {
+	return RotationKernels<Avx2>::toQuaternions(matrices, count, stride, qx, qy, qz, qw);
+}
+
+size_t toEulerAvx2(const float* qx, const float* qy, const float* qz, const float* qw, size_t count, float* rx, float* ry, float* rz) {
+	return RotationKernels<Avx2>::toEuler(qx, qy, qz, qw, count, rx, ry, rz);
+}
+#endif
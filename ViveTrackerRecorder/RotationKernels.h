@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <openvr.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ROTATION_X86
+#endif
+
+/*
+The rotation kernels, written once against a small vector interface V and instantiated for every
+instruction set in its own translation unit, so each one is compiled for its own target.
+V provides Float, width and elementwise operations; the remaining samples of a batch are
+left to the caller.
+*/
+template <typename V>
+struct RotationKernels {
+	typedef typename V::Float Float;
+
+	static Float copySign(Float magnitude, Float sign) {
+		Float signBit = V::set(-0.0f);
+		return V::orBits(V::andNotBits(signBit, magnitude), V::andBits(signBit, sign));
+	}
+
+	static Float abs(Float v) {
+		return V::andNotBits(V::set(-0.0f), v);
+	}
+
+	// atan2 with the argument reduced to [0, tan(pi/8)], polynomial from Cephes atanf
+	static Float atan2(Float y, Float x) {
+		Float ax = abs(x);
+		Float ay = abs(y);
+		Float high = V::max(ax, ay);
+		Float low = V::min(ax, ay);
+		Float zero = V::set(0);
+		//atan2(0, 0) is 0, not the NaN 0/0 would give
+		Float a = V::select(V::greater(high, zero), V::div(low, high), zero);
+
+		Float reduce = V::greater(a, V::set(0.41421356237f));
+		Float t = V::select(reduce, V::div(V::sub(a, V::set(1)), V::add(a, V::set(1))), a);
+		Float offset = V::select(reduce, V::set(0.78539816340f), zero);
+		Float z = V::mul(t, t);
+		Float p = V::set(8.05374449538e-2f);
+		p = V::sub(V::mul(p, z), V::set(1.38776856032e-1f));
+		p = V::add(V::mul(p, z), V::set(1.99777106478e-1f));
+		p = V::sub(V::mul(p, z), V::set(3.33329491539e-1f));
+		Float r = V::add(V::add(V::mul(V::mul(p, z), t), t), offset);
+
+		r = V::select(V::greater(ay, ax), V::sub(V::set(1.57079632679f), r), r);
+		r = V::select(V::less(x, zero), V::sub(V::set(3.14159265359f), r), r);
+		return copySign(r, y);
+	}
+
+	// Returns how many matrices were converted, a multiple of V::width
+	static size_t toQuaternions(const vr::HmdMatrix34_t* matrices, size_t count, size_t stride, float* qx, float* qy, float* qz, float* qw) {
+		const char* base = reinterpret_cast<const char*>(matrices);
+		Float zero = V::set(0);
+		Float one = V::set(1);
+		Float half = V::set(0.5f);
+		size_t i = 0;
+		for (; i + V::width <= count; i += V::width) {
+			const char* at = base + i * stride;
+			Float m00 = V::gather(at, stride, 0);
+			Float m01 = V::gather(at, stride, 1);
+			Float m02 = V::gather(at, stride, 2);
+			Float m10 = V::gather(at, stride, 4);
+			Float m11 = V::gather(at, stride, 5);
+			Float m12 = V::gather(at, stride, 6);
+			Float m20 = V::gather(at, stride, 8);
+			Float m21 = V::gather(at, stride, 9);
+			Float m22 = V::gather(at, stride, 10);
+
+			Float w = V::mul(V::sqrt(V::max(zero, V::add(V::add(one, m00), V::add(m11, m22)))), half);
+			Float x = V::mul(V::sqrt(V::max(zero, V::sub(V::add(one, m00), V::add(m11, m22)))), half);
+			Float y = V::mul(V::sqrt(V::max(zero, V::sub(V::add(one, m11), V::add(m00, m22)))), half);
+			Float z = V::mul(V::sqrt(V::max(zero, V::sub(V::add(one, m22), V::add(m00, m11)))), half);
+			V::store(qw + i, w);
+			V::store(qx + i, copySign(x, V::sub(m21, m12)));
+			V::store(qy + i, copySign(y, V::sub(m02, m20)));
+			V::store(qz + i, copySign(z, V::sub(m10, m01)));
+		}
+		V::finish();
+		return i;
+	}
+
+	// Returns how many quaternions were converted, a multiple of V::width
+	static size_t toEuler(const float* qx, const float* qy, const float* qz, const float* qw, size_t count, float* rx, float* ry, float* rz) {
+		Float one = V::set(1);
+		Float two = V::set(2);
+		Float degrees = V::set(57.2957795131f);
+		size_t i = 0;
+		for (; i + V::width <= count; i += V::width) {
+			Float x = V::load(qx + i);
+			Float y = V::load(qy + i);
+			Float z = V::load(qz + i);
+			Float w = V::load(qw + i);
+
+			Float sinr = V::mul(two, V::add(V::mul(w, x), V::mul(y, z)));
+			Float cosr = V::sub(one, V::mul(two, V::add(V::mul(x, x), V::mul(y, y))));
+			Float sinp = V::mul(two, V::sub(V::mul(w, y), V::mul(z, x)));
+			//cos(pitch) is the length of (sinr, cosr), atan2 keeps full precision near +-90 degrees where asin of a float does not
+			Float cosp = V::sqrt(V::add(V::mul(sinr, sinr), V::mul(cosr, cosr)));
+			Float siny = V::mul(two, V::add(V::mul(w, z), V::mul(x, y)));
+			Float cosy = V::sub(one, V::mul(two, V::add(V::mul(y, y), V::mul(z, z))));
+
+			V::store(rx + i, V::mul(atan2(sinr, cosr), degrees));
+			V::store(ry + i, V::mul(atan2(sinp, cosp), degrees));
+			V::store(rz + i, V::mul(atan2(siny, cosy), degrees));
+		}
+		V::finish();
+		return i;
+	}
+};
+
+#ifdef ROTATION_X86
+size_t toQuaternionsSse2(const vr::HmdMatrix34_t* matrices, size_t count, size_t stride, float* qx, float* qy, float* qz, float* qw);
+size_t toEulerSse2(const float* qx, const float* qy, const float* qz, const float* qw, size_t count, float* rx, float* ry, float* rz);
+size_t toQuaternionsAvx2(const vr::HmdMatrix34_t* matrices, size_t count, size_t stride, float* qx, float* qy, float* qz, float* qw);
+size_t toEulerAvx2(const float* qx, const float* qy, const float* qz, const float* qw, size_t count, float* rx, float* ry, float* rz);
+#endif
@@ -0,0 +1,87 @@
+#include "SampleStore.h"
+
+DeviceTrack::DeviceTrack(BlockArena* arena) : time(arena), px(arena), py(arena), pz(arena), qx(arena), qy(arena), qz(arena), qw(arena) {
+}
+
+void DeviceTrack::push(int64_t t, const vr::HmdVector3_t& pos, const vr::HmdQuaternion_t& rot) {
+	time.push_back(t);
+	px.push_back(pos.v[0]);
+	py.push_back(pos.v[1]);
+	pz.push_back(pos.v[2]);
+	qx.push_back((float)rot.x);
+	qy.push_back((float)rot.y);
+	qz.push_back((float)rot.z);
+	qw.push_back((float)rot.w);
+}
+
+KeyFrame DeviceTrack::frame(size_t i) const {
+	vr::HmdVector3_t pos = { { px[i], py[i], pz[i] } };
+	vr::HmdQuaternion_t rot;
+	rot.w = qw[i];
+	rot.x = qx[i];
+	rot.y = qy[i];
+	rot.z = qz[i];
+	return KeyFrame(time[i], pos, rot);
+}
+
+void DeviceTrack::reserve(size_t samples) {
+	time.reserve(samples);
+	px.reserve(samples);
+	py.reserve(samples);
+	pz.reserve(samples);
+	qx.reserve(samples);
+	qy.reserve(samples);
+	qz.reserve(samples);
+	qw.reserve(samples);
+}
+
+void DeviceTrack::clear() {
+	time.clear();
+	px.clear();
+	py.clear();
+	pz.clear();
+	qx.clear();
+	qy.clear();
+	qz.clear();
+	qw.clear();
+}
+
+size_t DeviceTrack::bytes() const {
+	return time.capacity() * sizeof(int64_t) + (px.capacity() + py.capacity() + pz.capacity()) * sizeof(float)
+		+ (qx.capacity() + qy.capacity() + qz.capacity() + qw.capacity()) * sizeof(float);
+}
+
+SampleStore::SampleStore(size_t blockBytes, bool hugePages) : arena(new BlockArena(blockBytes, hugePages)) {
+	tracks.reserve(vr::k_unMaxTrackedDeviceCount);
+	for (uint32_t i = 0; i < vr::k_unMaxTrackedDeviceCount; i++) {
+		tracks.emplace_back(arena.get());
+	}
+}
+
+void SampleStore::reserve(const std::vector<int>& deviceList, size_t samplesPerDevice) {
+	for (int devId : deviceList) {
+		tracks[devId].reserve(samplesPerDevice);
+	}
+}
+
+size_t SampleStore::totalSamples() const {
+	size_t total = 0;
+	for (auto& track : tracks) {
+		total += track.size();
+	}
+	return total;
+}
+
+size_t SampleStore::bytes() const {
+	size_t total = 0;
+	for (auto& track : tracks) {
+		total += track.bytes();
+	}
+	return total;
+}
+
+void SampleStore::clear() {
+	for (auto& track : tracks) {
+		track.clear();
+	}
+}
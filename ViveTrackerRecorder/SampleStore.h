@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <openvr.h>
+
+#include "Arena.h"
+
+/*
+A device as it is named in a take, so the take can be exported without the runtime
+*/
+struct RecordedDevice {
+public:
+	uint32_t id;
+	std::string name;
+};
+
+struct KeyFrame {
+public:
+	// nanoseconds since the take started
+	int64_t time;
+	vr::HmdVector3_t position;
+	vr::HmdQuaternion_t rotation;
+
+	KeyFrame(int64_t time, vr::HmdVector3_t pos, vr::HmdQuaternion_t rot): time(time), position(pos), rotation(rot) {}
+};
+
+/*
+All samples of one device, stored column by column: every channel is its own array,
+so filters and exporters can stream over a single channel.
+The columns grow in arena blocks, so recorded samples are never moved while recording.
+Rotations are kept as float, the matrices they come from are float as well.
+*/
+struct DeviceTrack {
+public:
+	ChunkedArray<int64_t> time;
+	ChunkedArray<float> px, py, pz;
+	ChunkedArray<float> qx, qy, qz, qw;
+	// memory a sample takes in the columns
+	static const size_t sampleBytes = sizeof(int64_t) + 7 * sizeof(float);
+
+	explicit DeviceTrack(BlockArena* arena);
+
+	size_t size() const {
+		return time.size();
+	}
+	bool empty() const {
+		return time.empty();
+	}
+
+	void push(int64_t t, const vr::HmdVector3_t& pos, const vr::HmdQuaternion_t& rot);
+	void push(const KeyFrame& frame) {
+		push(frame.time, frame.position, frame.rotation);
+	}
+	// Gathers the channels of sample i back into a single frame
+	KeyFrame frame(size_t i) const;
+
+	void reserve(size_t samples);
+	void clear();
+	size_t bytes() const;
+};
+
+/*
+Samples of all devices, indexed directly by vr::TrackedDeviceIndex_t.
+All tracks share one arena; reserve() takes the memory for an expected take length up front.
+*/
+class SampleStore {
+private:
+	std::unique_ptr<BlockArena> arena;
+	std::vector<DeviceTrack> tracks;
+public:
+	SampleStore(size_t blockBytes = 256 << 10, bool hugePages = false);
+
+	DeviceTrack& operator[](vr::TrackedDeviceIndex_t devId) {
+		return tracks[devId];
+	}
+	const DeviceTrack& operator[](vr::TrackedDeviceIndex_t devId) const {
+		return tracks[devId];
+	}
+
+	void reserve(const std::vector<int>& deviceList, size_t samplesPerDevice);
+	size_t totalSamples() const;
+	size_t bytes() const;
+	void clear();
+
+	const BlockArena& getArena() const {
+		return *arena;
+	}
+};
@@ -0,0 +1,131 @@
+#include "Scheduler.h"
+
+#include <csignal>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <conio.h>
+#pragma comment(lib, "winmm.lib")
+#else
+#include <cstdio>
+#endif
+
+//sleeping is only trusted up to this much before the deadline, the rest is spent spinning
+static const std::chrono::microseconds spinWindow(1500);
+
+RateScheduler::RateScheduler(double rateHz) {
+	period = rateHz > 0 ? std::chrono::nanoseconds((long long)(1e9 / rateHz)) : std::chrono::nanoseconds(0);
+#ifdef _WIN32
+	//default timer resolution is 15.6 ms, which would make every sleep overshoot
+	timeBeginPeriod(1);
+#endif
+}
+
+RateScheduler::~RateScheduler() {
+#ifdef _WIN32
+	//the resolution is counted per process, a session would otherwise raise it once more with every take
+	timeEndPeriod(1);
+#endif
+}
+
+void RateScheduler::start() {
+	started = next = woke = Clock::now();
+	ticks = 0;
+	missed = 0;
+}
+
+bool RateScheduler::wait(const std::atomic<bool>& stop) {
+	if (stop.load(std::memory_order_relaxed)) {
+		return false;
+	}
+	if (period.count() == 0) {
+		woke = Clock::now();
+		ticks++;
+		return true;
+	}
+	auto now = Clock::now();
+	if (now > next + period) {
+		//we are more than a full period late: count the ticks we lost and re-align instead of bursting to catch up
+		auto late = (now - next) / period;
+		missed += late;
+		next += late * period;
+	}
+	while (true) {
+		now = Clock::now();
+		if (now >= next) {
+			break;
+		}
+		if (stop.load(std::memory_order_relaxed)) {
+			return false;
+		}
+		auto remaining = next - now;
+		if (remaining > spinWindow) {
+			std::this_thread::sleep_for(remaining - spinWindow);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+	woke = now;
+	next += period;
+	ticks++;
+	return true;
+}
+
+double RateScheduler::rate() const {
+	return period.count() > 0 ? 1e9 / period.count() : 0;
+}
+
+std::atomic<bool>& stopRequested() {
+	static std::atomic<bool> flag(false);
+	return flag;
+}
+
+static void onStopSignal(int) {
+	stopRequested().store(true);
+}
+
+void installStopHandlers(bool watchKeyboard) {
+	std::signal(SIGINT, onStopSignal);
+	std::signal(SIGTERM, onStopSignal);
+	if (watchKeyboard) {
+		//blocks on the console instead of polling it from the capture loop
+		std::thread([]() {
+#ifdef _WIN32
+			_getch();
+#else
+			std::getchar();
+#endif
+			stopRequested().store(true);
+		}).detach();
+	}
+}
+
+std::atomic<bool>& nextTakeRequested() {
+	static std::atomic<bool> flag(false);
+	return flag;
+}
+
+void installSessionHandlers() {
+	installStopHandlers(false);
+	std::thread([]() {
+		while (!stopRequested()) {
+#ifdef _WIN32
+			int key = _getch();
+#else
+			int key = std::getchar();
+			if (key == EOF) {
+				break;
+			}
+			if (key == '\n') {
+				continue;
+			}
+#endif
+			if (key == 'q' || key == 'Q' || key == 27) {
+				stopRequested().store(true);
+			} else {
+				nextTakeRequested().store(true);
+			}
+		}
+	}).detach();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/*
+Paces the capture loop at a fixed rate on the monotonic clock.
+Waits by sleeping until shortly before the deadline and spinning for the rest, which keeps the
+sample spacing uniform without pinning a core. A rate of 0 runs as fast as possible.
+*/
+class RateScheduler {
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	std::chrono::nanoseconds period;
+	Clock::time_point started;
+	Clock::time_point woke;
+	Clock::time_point next;
+	long long ticks = 0;
+	long long missed = 0;
+public:
+	RateScheduler(double rateHz);
+	~RateScheduler();
+	// every scheduler holds one reference on the raised timer resolution
+	RateScheduler(const RateScheduler&) = delete;
+	RateScheduler& operator=(const RateScheduler&) = delete;
+
+	void start();
+	// Blocks until the next tick is due. Returns false as soon as stop is set.
+	bool wait(const std::atomic<bool>& stop);
+	// Nanoseconds from start() to when wait() returned, from the clock read that ended the wait
+	int64_t tickTime() const {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(woke - started).count();
+	}
+	// Nanoseconds since start()
+	int64_t elapsed() const {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started).count();
+	}
+
+	long long tickCount() const {
+		return ticks;
+	}
+	// Ticks that could not be served because the loop body took longer than a period
+	long long missedDeadlines() const {
+		return missed;
+	}
+	double rate() const;
+};
+
+/*
+Flag that ends the recording. It is set by Ctrl+C / SIGTERM and, if watchKeyboard is true,
+by any key press in the console.
+*/
+std::atomic<bool>& stopRequested();
+void installStopHandlers(bool watchKeyboard);
+
+/*
+For sessions of several takes: any key sets nextTakeRequested, which the session clears once it cut the take.
+q or Esc end the session through stopRequested, as do Ctrl+C and SIGTERM.
+*/
+std::atomic<bool>& nextTakeRequested();
+void installSessionHandlers();
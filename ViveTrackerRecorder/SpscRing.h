@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/*
+Wait-free ring buffer for exactly one producer thread and one consumer thread.
+The capacity is rounded up to a power of two. push never blocks: when the ring is full the sample
+is dropped and counted as an overrun, so the producer's timing is never affected by a slow consumer.
+*/
+template <typename T>
+class SpscRing {
+private:
+	std::vector<T> slots;
+	size_t mask;
+
+	// written by the producer only, head and tail live on their own cache lines
+	alignas(64) std::atomic<size_t> head;
+	size_t cachedTail = 0;
+	std::atomic<long long> overruns;
+	std::atomic<size_t> highWater;
+
+	// written by the consumer only
+	alignas(64) std::atomic<size_t> tail;
+	size_t cachedHead = 0;
+
+	static size_t roundUp(size_t n) {
+		size_t result = 1;
+		while (result < n) result <<= 1;
+		return result;
+	}
+public:
+	explicit SpscRing(size_t capacity) : slots(roundUp(capacity < 2 ? 2 : capacity)), head(0), overruns(0), highWater(0), tail(0) {
+		mask = slots.size() - 1;
+	}
+
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	// Producer side. Returns false and counts an overrun if the ring is full.
+	bool push(const T& item) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h - cachedTail >= slots.size()) {
+			cachedTail = tail.load(std::memory_order_acquire);
+			if (h - cachedTail >= slots.size()) {
+				overruns.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+		}
+		slots[h & mask] = item;
+		head.store(h + 1, std::memory_order_release);
+		//cachedTail is only refreshed when the ring looks full, so it overstates the occupancy;
+		//the real tail is read only when that estimate would raise the mark
+		size_t used = h + 1 - cachedTail;
+		if (used > highWater.load(std::memory_order_relaxed)) {
+			cachedTail = tail.load(std::memory_order_acquire);
+			used = h + 1 - cachedTail;
+			if (used > highWater.load(std::memory_order_relaxed)) {
+				highWater.store(used, std::memory_order_relaxed);
+			}
+		}
+		return true;
+	}
+
+	// Consumer side. Returns false if the ring is empty.
+	bool pop(T& item) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t == cachedHead) {
+			cachedHead = head.load(std::memory_order_acquire);
+			if (t == cachedHead) {
+				return false;
+			}
+		}
+		item = slots[t & mask];
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Number of items waiting, safe to read from any thread (approximate while both sides are running)
+	size_t size() const {
+		size_t t = tail.load(std::memory_order_acquire);
+		size_t h = head.load(std::memory_order_acquire);
+		return h - t;
+	}
+
+	size_t capacity() const {
+		return slots.size();
+	}
+
+	// Highest occupancy seen by the producer, as seen at push time
+	size_t highWaterMark() const {
+		return highWater.load(std::memory_order_relaxed);
+	}
+
+	long long overrunCount() const {
+		return overruns.load(std::memory_order_relaxed);
+	}
+};
@@ -0,0 +1,81 @@
+#include "StaticPose.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const double pi = 3.14159265358979323846;
+
+PoseSpread measureSpread(const DeviceTrack& track) {
+	PoseSpread spread;
+	size_t count = track.size();
+	spread.samples = count;
+	if (count == 0) {
+		return spread;
+	}
+
+	//q and -q are the same rotation, all of them are summed on the side of the first one
+	double first[4] = { track.qw[0], track.qx[0], track.qy[0], track.qz[0] };
+	double position[3] = { 0, 0, 0 };
+	double rotation[4] = { 0, 0, 0, 0 };
+	for (size_t i = 0; i < count; i++) {
+		position[0] += track.px[i];
+		position[1] += track.py[i];
+		position[2] += track.pz[i];
+		double q[4] = { track.qw[i], track.qx[i], track.qy[i], track.qz[i] };
+		double sign = q[0] * first[0] + q[1] * first[1] + q[2] * first[2] + q[3] * first[3] < 0 ? -1 : 1;
+		for (int c = 0; c < 4; c++) {
+			rotation[c] += q[c] * sign;
+		}
+	}
+	double length = std::sqrt(rotation[0] * rotation[0] + rotation[1] * rotation[1] + rotation[2] * rotation[2] + rotation[3] * rotation[3]);
+	auto& mean = spread.mean;
+	mean.time = track.time[0];
+	for (int c = 0; c < 3; c++) {
+		mean.position.v[c] = (float)(position[c] / count);
+	}
+	mean.rotation.w = rotation[0] / length;
+	mean.rotation.x = rotation[1] / length;
+	mean.rotation.y = rotation[2] / length;
+	mean.rotation.z = rotation[3] / length;
+
+	double m[4] = { mean.rotation.w, mean.rotation.x, mean.rotation.y, mean.rotation.z };
+	double positionSum = 0, rotationSum = 0;
+	for (size_t i = 0; i < count; i++) {
+		double dx = track.px[i] - mean.position.v[0], dy = track.py[i] - mean.position.v[1], dz = track.pz[i] - mean.position.v[2];
+		double distance = dx * dx + dy * dy + dz * dz;
+		positionSum += distance;
+		spread.maxPosition = std::max(spread.maxPosition, std::sqrt(distance));
+
+		//the chord between two unit quaternions is 2 sin(angle / 4), precise for small angles unlike acos of their dot product
+		double q[4] = { track.qw[i], track.qx[i], track.qy[i], track.qz[i] };
+		double sign = q[0] * m[0] + q[1] * m[1] + q[2] * m[2] + q[3] * m[3] < 0 ? -1 : 1;
+		double chord = 0;
+		for (int c = 0; c < 4; c++) {
+			double d = q[c] * sign - m[c];
+			chord += d * d;
+		}
+		double angle = 4 * std::asin(std::min(1.0, std::sqrt(chord) / 2)) * 180 / pi;
+		rotationSum += angle * angle;
+		spread.maxRotation = std::max(spread.maxRotation, angle);
+	}
+	spread.position = std::sqrt(positionSum / count);
+	spread.rotation = std::sqrt(rotationSum / count);
+	return spread;
+}
+
+bool isStatic(const PoseSpread& spread, const StaticOptions& options) {
+	return spread.samples > 0 && spread.position <= options.positionTolerance && spread.rotation <= options.rotationTolerance;
+}
+
+DeviceCurves staticCurves(const std::string& objName, const KeyFrame& pose) {
+	DeviceCurves curves;
+	curves.name = objName;
+	curves.isStatic = true;
+	auto euler = toEulerAngles(pose.rotation);
+	float values[DeviceCurves::COUNT] = { pose.position.v[0], pose.position.v[1], pose.position.v[2], euler.v[0], euler.v[1], euler.v[2] };
+	for (int c = 0; c < DeviceCurves::COUNT; c++) {
+		curves.channels[c].time.push_back(pose.time);
+		curves.channels[c].value.push_back(values[c]);
+	}
+	return curves;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+
+#include "Curves.h"
+#include "SampleStore.h"
+
+/*
+How much the pose of a device may vary over a whole take for it to be stored once, as standard deviations.
+Base stations and trackers on a tripod stay well below a millimeter and a tenth of a degree.
+*/
+struct StaticOptions {
+public:
+	double positionTolerance = 0; // meters
+	double rotationTolerance = 0; // degrees
+
+	bool enabled() const {
+		return positionTolerance > 0 || rotationTolerance > 0;
+	}
+};
+
+/*
+The mean pose of a track, at the time of its first sample, and how far its samples lie from it
+*/
+struct PoseSpread {
+public:
+	KeyFrame mean = KeyFrame(0, {}, {});
+	size_t samples = 0;
+	// standard deviations
+	double position = 0; // meters
+	double rotation = 0; // degrees
+	// the sample furthest from the mean
+	double maxPosition = 0; // meters
+	double maxRotation = 0; // degrees
+};
+
+/*
+Mean position and rotation of all samples in one pass over the columns, then their spread in a second one.
+The rotations are averaged as quaternions, which is exact enough for the small spreads it is used for.
+*/
+PoseSpread measureSpread(const DeviceTrack& track);
+
+// Whether a track varies less than the tolerances over the whole take; an empty track is not static
+bool isStatic(const PoseSpread& spread, const StaticOptions& options);
+
+/*
+Curves of a device that does not move: one key per channel, written as the transform of the node instead of as curves
+*/
+DeviceCurves staticCurves(const std::string& objName, const KeyFrame& pose);
@@ -0,0 +1,175 @@
+#include "StatusDisplay.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+StatusDisplay::StatusDisplay(Recorder& recorder, const std::vector<int>& deviceList, const std::vector<std::string>& names, Console& console, double refreshHz)
+	: recorder(recorder), deviceList(deviceList), names(names), console(console), interval((int)(1000 / refreshHz)), stopFlag(false),
+	windowCounts(deviceList.size(), 0), rates(deviceList.size(), 0) {
+}
+
+StatusDisplay::~StatusDisplay() {
+	stop();
+}
+
+void StatusDisplay::start() {
+	stopFlag = false;
+	windowStart = Clock::now();
+	thread = std::thread(&StatusDisplay::run, this);
+}
+
+void StatusDisplay::stop() {
+	stopFlag = true;
+	if (thread.joinable()) {
+		thread.join();
+		draw(render());
+		std::cout.flush();
+	}
+}
+
+void StatusDisplay::run() {
+#ifdef _WIN32
+	//whatever else needs the CPU goes first, the display can wait
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+	auto next = Clock::now();
+	while (!stopFlag) {
+		draw(render());
+		std::cout.flush();
+		next += interval;
+		std::this_thread::sleep_until(next);
+	}
+}
+
+/*
+Devices that drop out keep their row, their rate falls to 0 and the last pose stays
+*/
+void StatusDisplay::addRecordedDevices() {
+	uint64_t recorded = registry->recordedDevices();
+	if (recorded == listedDevices) {
+		return;
+	}
+	listedDevices = recorded;
+	for (int devId = 0; devId < 64; devId++) {
+		if ((recorded >> devId & 1) == 0 || std::find(deviceList.begin(), deviceList.end(), devId) != deviceList.end()) {
+			continue;
+		}
+		deviceList.push_back(devId);
+		names.resize(deviceList.size() - 1);
+		names.push_back(registry->recordedDevice(devId).name);
+		windowCounts.push_back(recorder.receivedCount(devId));
+		rates.push_back(0);
+	}
+}
+
+/*
+Fixed column widths, so a changing number only rewrites its own characters
+*/
+std::vector<std::string> StatusDisplay::render() {
+	if (registry) {
+		addRecordedDevices();
+	}
+	//rates are counted over windows of a second, refreshing them every frame would only show noise
+	auto now = Clock::now();
+	double windowSeconds = std::chrono::duration<double>(now - windowStart).count();
+	if (windowSeconds >= 1) {
+		for (size_t i = 0; i < deviceList.size(); i++) {
+			long long count = recorder.receivedCount(deviceList[i]);
+			rates[i] = (count - windowCounts[i]) / windowSeconds;
+			windowCounts[i] = count;
+		}
+		windowStart = now;
+	}
+
+	std::vector<std::string> lines;
+	char line[256];
+	int ms = recorder.elapsed();
+	if (recorder.isCommitted()) {
+		snprintf(line, sizeof(line), "Recording %02d:%02d.%d   ring %7zu/%zu   dropped %lld", ms / 60000, ms / 1000 % 60, ms / 100 % 10,
+			recorder.ringOccupancy(), recorder.ringCapacity(), recorder.ringOverruns());
+	} else {
+		//as wide as the recording line, so the commit only rewrites its start
+		snprintf(line, sizeof(line), "Pre-roll  %5.1f s   ring %7zu/%zu   dropped %lld", recorder.preRollSeconds(),
+			recorder.ringOccupancy(), recorder.ringCapacity(), recorder.ringOverruns());
+	}
+	lines.push_back(line);
+	snprintf(line, sizeof(line), "%4s %-20s %8s %8s %8s %8s %7s %7s %7s %7s %9s", "id", "device", "rate", "x", "y", "z", "qx", "qy", "qz", "qw", "invalid");
+	lines.push_back(line);
+	KeyFrame frame(0, {}, {});
+	for (size_t i = 0; i < deviceList.size(); i++) {
+		int devId = deviceList[i];
+		std::string name = i < names.size() ? names[i].substr(0, 20) : "";
+		if (recorder.latestFrame(devId, frame)) {
+			snprintf(line, sizeof(line), "%4d %-20s %8.1f %8.3f %8.3f %8.3f %7.3f %7.3f %7.3f %7.3f %9lld", devId, name.c_str(), rates[i],
+				frame.position.v[0], frame.position.v[1], frame.position.v[2], frame.rotation.x, frame.rotation.y, frame.rotation.z, frame.rotation.w,
+				recorder.invalidCount(devId));
+		} else {
+			snprintf(line, sizeof(line), "%4d %-20s %8.1f %-62s %9lld", devId, name.c_str(), rates[i], "  no valid pose yet", recorder.invalidCount(devId));
+		}
+		lines.push_back(line);
+	}
+	return lines;
+}
+
+/*
+Writes the changed part of every changed line, moving there and back with relative cursor escapes.
+Without ANSI support the whole block is printed again over the old one.
+*/
+void StatusDisplay::draw(const std::vector<std::string>& lines) {
+	if (shown.empty()) {
+		for (auto& line : lines) {
+			std::cout << line << "\n";
+		}
+		shown = lines;
+		return;
+	}
+	if (!console.usesAnsi()) {
+		console.moveCursor(-(short)shown.size());
+		for (size_t i = 0; i < lines.size(); i++) {
+			std::cout << lines[i] << std::string(i < shown.size() && shown[i].size() > lines[i].size() ? shown[i].size() - lines[i].size() : 0, ' ') << "\n";
+		}
+		shown = lines;
+		return;
+	}
+
+	std::string out;
+	size_t rows = shown.size();
+	for (size_t i = 0; i < lines.size() && i < rows; i++) {
+		auto& before = shown[i];
+		auto& after = lines[i];
+		size_t first = 0;
+		while (first < before.size() && first < after.size() && before[first] == after[first]) {
+			first++;
+		}
+		if (first == before.size() && first == after.size()) {
+			continue;
+		}
+		size_t last = std::max(before.size(), after.size());
+		while (last > first && last <= before.size() && last <= after.size() && before[last - 1] == after[last - 1]) {
+			last--;
+		}
+		out += "\x1b[" + std::to_string(rows - i) + "A\r";
+		if (first > 0) {
+			out += "\x1b[" + std::to_string(first) + "C";
+		}
+		out += after.substr(first, std::min(last, after.size()) - first);
+		if (after.size() < before.size()) {
+			//the rest of the old line
+			out += "\x1b[K";
+		}
+		out += "\x1b[" + std::to_string(rows - i) + "B\r";
+	}
+	//rows of devices that came up are new lines below the block
+	for (size_t i = rows; i < lines.size(); i++) {
+		out += lines[i] + "\n";
+	}
+	if (!out.empty()) {
+		std::cout << out;
+	}
+	shown = lines;
+}
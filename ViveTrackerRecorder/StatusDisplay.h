@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Console.h"
+#include "DeviceRegistry.h"
+#include "Recorder.h"
+
+/*
+Live view of a running take: last pose, sample rate and invalid count per device, ring occupancy and dropped samples.
+It runs on its own low priority thread at a fixed refresh rate and only reads the recorder's counters, so the capture
+and consumer threads never format or print anything. Each refresh writes only the characters that changed since the
+last one, in a single write.
+*/
+class StatusDisplay {
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	Recorder& recorder;
+	const DeviceRegistry* registry = nullptr;
+	// the registry's recorded set the rows were last brought up to date with
+	uint64_t listedDevices = 0;
+	std::vector<int> deviceList;
+	std::vector<std::string> names;
+	Console& console;
+	std::chrono::milliseconds interval;
+	std::atomic<bool> stopFlag;
+	std::thread thread;
+
+	// the lines currently on the screen, the cursor is on the line below them
+	std::vector<std::string> shown;
+	// per device, stored samples at the start of the current rate window
+	std::vector<long long> windowCounts;
+	std::vector<double> rates;
+	Clock::time_point windowStart;
+
+	void run();
+	void addRecordedDevices();
+	std::vector<std::string> render();
+	void draw(const std::vector<std::string>& lines);
+public:
+	// names go by position in deviceList
+	StatusDisplay(Recorder& recorder, const std::vector<int>& deviceList, const std::vector<std::string>& names, Console& console, double refreshHz = 15);
+	~StatusDisplay();
+
+	// Adds a row for every device the registry starts recording during the take. Call before start().
+	void setRegistry(const DeviceRegistry* registry) {
+		this->registry = registry;
+	}
+
+	void start();
+	// Draws a last time with the final numbers
+	void stop();
+};
@@ -1,11 +0,0 @@
-#pragma once
-class StopWatch {
-private:
-	long long frequency;
-	long long lastTime;
-public:
-	StopWatch();
-	void start();
-	int time();
-};
-
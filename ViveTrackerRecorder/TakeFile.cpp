@@ -0,0 +1,449 @@
+#include "TakeFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+static const char takeMagic[4] = { 'V', 'T', 'R', '1' };
+static const uint32_t takeVersion = 3;
+// version 1 stored sample times in milliseconds, version 2 had no flags
+static const uint32_t millisecondVersion = 1;
+static const uint32_t unflaggedVersion = 2;
+static const uint32_t gatedFlag = 1;
+static const uint32_t dataTag = 0x41544144; // "DATA"
+static const uint32_t deviceTag = 0x49564544; // "DEVI"
+static const uint32_t statsTag = 0x54415453; // "STAT"
+static const uint32_t gateTag = 0x45544147; // "GATE"
+// smallest-three components lie in [-1/sqrt(2), 1/sqrt(2)]
+static const double rotationScale = 32767 * 1.41421356237309504880;
+
+static inline uint64_t zigzag(int64_t v) {
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+	while (v >= 0x80) {
+		out.push_back((uint8_t)(v | 0x80));
+		v >>= 7;
+	}
+	out.push_back((uint8_t)v);
+}
+
+static inline uint64_t getVarint(const uint8_t*& p, const uint8_t* end) {
+	uint64_t v = 0;
+	int shift = 0;
+	while (p < end && shift < 64) {
+		uint8_t b = *p++;
+		v |= (uint64_t)(b & 0x7F) << shift;
+		if (!(b & 0x80)) {
+			return v;
+		}
+		shift += 7;
+	}
+	throw std::runtime_error("Corrupt take chunk");
+}
+
+/*
+Minimum, maximum and sum, then the buckets that are not empty as (index delta, count) pairs
+*/
+static void putHistogram(std::vector<uint8_t>& out, const Histogram& histogram) {
+	putVarint(out, zigzag(histogram.lowest()));
+	putVarint(out, zigzag(histogram.highest()));
+	putVarint(out, zigzag(histogram.sum()));
+	uint64_t used = 0;
+	for (int bucket = 0; bucket < Histogram::bucketCount; bucket++) {
+		used += histogram.countAt(bucket) > 0 ? 1 : 0;
+	}
+	putVarint(out, used);
+	int last = 0;
+	for (int bucket = 0; bucket < Histogram::bucketCount; bucket++) {
+		if (histogram.countAt(bucket) > 0) {
+			putVarint(out, (uint64_t)(bucket - last));
+			putVarint(out, histogram.countAt(bucket));
+			last = bucket;
+		}
+	}
+}
+
+static void getHistogram(const uint8_t*& p, const uint8_t* end, Histogram& histogram) {
+	int64_t lowest = unzigzag(getVarint(p, end));
+	int64_t highest = unzigzag(getVarint(p, end));
+	int64_t sum = unzigzag(getVarint(p, end));
+	uint64_t used = getVarint(p, end);
+	std::vector<std::pair<int, uint64_t>> buckets;
+	int bucket = 0;
+	for (uint64_t i = 0; i < used && i < Histogram::bucketCount; i++) {
+		bucket += (int)getVarint(p, end);
+		buckets.push_back({ bucket, getVarint(p, end) });
+	}
+	histogram.restore(buckets, lowest, highest, sum);
+}
+
+/*
+Smallest-three: drop the largest component (it follows from the others since |q| = 1)
+and flip the sign so the dropped one is positive
+*/
+static inline int encodeRotation(const KeyFrame& frame, int32_t out[3]) {
+	double q[4] = { frame.rotation.x, frame.rotation.y, frame.rotation.z, frame.rotation.w };
+	int largest = 0;
+	for (int i = 1; i < 4; i++) {
+		if (std::fabs(q[i]) > std::fabs(q[largest])) {
+			largest = i;
+		}
+	}
+	double sign = q[largest] < 0 ? -1 : 1;
+	int n = 0;
+	for (int i = 0; i < 4; i++) {
+		if (i == largest) continue;
+		double v = std::max(-32767.0, std::min(32767.0, std::round(q[i] * sign * rotationScale)));
+		out[n++] = (int32_t)v;
+	}
+	return largest;
+}
+
+static inline vr::HmdQuaternion_t decodeRotation(int largest, const int32_t in[3]) {
+	double q[4];
+	double sum = 0;
+	int n = 0;
+	for (int i = 0; i < 4; i++) {
+		if (i == largest) continue;
+		q[i] = in[n++] / rotationScale;
+		sum += q[i] * q[i];
+	}
+	q[largest] = std::sqrt(std::max(0.0, 1 - sum));
+	vr::HmdQuaternion_t rot;
+	rot.x = q[0];
+	rot.y = q[1];
+	rot.z = q[2];
+	rot.w = q[3];
+	return rot;
+}
+
+TakeWriter::TakeWriter(const std::string& filename, const std::vector<RecordedDevice>& devices, const TakeFileOptions& options)
+	: file(new std::ofstream(filename, std::ios::binary | std::ios::trunc)), out(file.get()), options(options), pending(vr::k_unMaxTrackedDeviceCount) {
+	if (!*file) {
+		throw std::runtime_error("Could not create take file: " + filename);
+	}
+	writeHeader(devices);
+}
+
+TakeWriter::TakeWriter(std::ostream& out, const std::vector<RecordedDevice>& devices, const TakeFileOptions& options)
+	: out(&out), options(options), pending(vr::k_unMaxTrackedDeviceCount) {
+	writeHeader(devices);
+}
+
+/*
+Never throws, an error that unwinds the stack must not meet a second one
+*/
+TakeWriter::~TakeWriter() {
+	try {
+		close();
+	} catch (...) {
+	}
+}
+
+void TakeWriter::fail(const std::string& message) {
+	failed = true;
+	throw std::runtime_error(message);
+}
+
+void TakeWriter::writeBytes(const void* data, size_t size) {
+	out->write(static_cast<const char*>(data), size);
+	if (out->fail()) {
+		fail("Could not write the take file, the disk may be full");
+	}
+	written += size;
+}
+
+void TakeWriter::writeHeader(const std::vector<RecordedDevice>& devices) {
+	writeBytes(takeMagic, sizeof(takeMagic));
+	writeBytes(&takeVersion, sizeof(takeVersion));
+	writeBytes(&options.positionStep, sizeof(options.positionStep));
+	uint32_t flags = options.gated ? gatedFlag : 0;
+	writeBytes(&flags, sizeof(flags));
+	uint32_t count = (uint32_t)devices.size();
+	writeBytes(&count, sizeof(count));
+	for (auto& device : devices) {
+		uint16_t length = (uint16_t)std::min<size_t>(device.name.size(), 0xFFFF);
+		writeBytes(&device.id, sizeof(device.id));
+		writeBytes(&length, sizeof(length));
+		writeBytes(device.name.data(), length);
+		if (device.id < 64) {
+			declared |= 1ull << device.id;
+		}
+	}
+}
+
+void TakeWriter::addDevice(const RecordedDevice& device) {
+	if (device.id >= 64 || (declared >> device.id & 1)) {
+		return;
+	}
+	declared |= 1ull << device.id;
+	uint16_t length = (uint16_t)std::min<size_t>(device.name.size(), 0xFFFF);
+	uint32_t header[4] = { deviceTag, device.id, 0, (uint32_t)(sizeof(length) + length) };
+	writeBytes(header, sizeof(header));
+	writeBytes(&length, sizeof(length));
+	writeBytes(device.name.data(), length);
+}
+
+void TakeWriter::writeChunk(uint32_t devId, const KeyFrame* frames, size_t count) {
+	buffer.clear();
+	int64_t lastTime = 0;
+	int64_t lastPos[3] = { 0, 0, 0 };
+	int32_t lastRot[3] = { 0, 0, 0 };
+	int lastLargest = -1;
+	for (size_t i = 0; i < count; i++) {
+		auto& frame = frames[i];
+		int32_t rot[3];
+		int largest = encodeRotation(frame, rot);
+		if (largest != lastLargest) {
+			//deltas only make sense between the same three components
+			lastRot[0] = lastRot[1] = lastRot[2] = 0;
+			lastLargest = largest;
+		}
+		//the index of the dropped component rides in the low bits of the time delta
+		putVarint(buffer, (zigzag(frame.time - lastTime) << 2) | (uint64_t)largest);
+		lastTime = frame.time;
+		for (int c = 0; c < 3; c++) {
+			int64_t pos = (int64_t)std::llround(frame.position.v[c] / options.positionStep);
+			putVarint(buffer, zigzag(pos - lastPos[c]));
+			lastPos[c] = pos;
+		}
+		for (int c = 0; c < 3; c++) {
+			putVarint(buffer, zigzag((int64_t)rot[c] - lastRot[c]));
+			lastRot[c] = rot[c];
+		}
+	}
+	uint32_t header[4] = { dataTag, devId, (uint32_t)count, (uint32_t)buffer.size() };
+	writeBytes(header, sizeof(header));
+	writeBytes(buffer.data(), buffer.size());
+}
+
+void TakeWriter::writeStats(const CaptureStats& stats) {
+	buffer.clear();
+	buffer.resize(sizeof(stats.rate));
+	std::memcpy(buffer.data(), &stats.rate, sizeof(stats.rate));
+	putHistogram(buffer, stats.poseReads);
+	for (auto& device : stats.devices) {
+		putVarint(buffer, device.id);
+		putVarint(buffer, (uint64_t)device.samples);
+		putVarint(buffer, (uint64_t)device.invalid);
+		putHistogram(buffer, device.intervals);
+	}
+	uint32_t header[4] = { statsTag, 0, (uint32_t)stats.devices.size(), (uint32_t)buffer.size() };
+	writeBytes(header, sizeof(header));
+	writeBytes(buffer.data(), buffer.size());
+
+	//a chunk of its own, so readers that predate it skip it
+	buffer.clear();
+	uint32_t gatedDevices = 0;
+	for (auto& device : stats.devices) {
+		if (device.gated > 0) {
+			putVarint(buffer, device.id);
+			putVarint(buffer, (uint64_t)device.gated);
+			gatedDevices++;
+		}
+	}
+	if (gatedDevices > 0) {
+		uint32_t gateHeader[4] = { gateTag, 0, gatedDevices, (uint32_t)buffer.size() };
+		writeBytes(gateHeader, sizeof(gateHeader));
+		writeBytes(buffer.data(), buffer.size());
+	}
+}
+
+void TakeWriter::append(uint32_t devId, const KeyFrame& frame) {
+	auto& frames = pending[devId];
+	frames.push_back(frame);
+	if (frames.size() >= options.chunkSamples) {
+		writeChunk(devId, frames.data(), frames.size());
+		frames.clear();
+	}
+}
+
+void TakeWriter::writeTrack(uint32_t devId, const DeviceTrack& track) {
+	std::vector<KeyFrame> frames;
+	frames.reserve(std::min<size_t>(track.size(), options.chunkSamples));
+	for (size_t i = 0; i < track.size(); i++) {
+		frames.push_back(track.frame(i));
+		if (frames.size() >= options.chunkSamples) {
+			writeChunk(devId, frames.data(), frames.size());
+			frames.clear();
+		}
+	}
+	if (!frames.empty()) {
+		writeChunk(devId, frames.data(), frames.size());
+	}
+}
+
+void TakeWriter::close() {
+	if (closed) {
+		return;
+	}
+	closed = true;
+	if (failed) {
+		if (file) {
+			file->close();
+		}
+		return;
+	}
+	for (uint32_t devId = 0; devId < pending.size(); devId++) {
+		if (!pending[devId].empty()) {
+			writeChunk(devId, pending[devId].data(), pending[devId].size());
+			pending[devId].clear();
+		}
+	}
+	out->flush();
+	if (file) {
+		file->close();
+	}
+	if (out->fail()) {
+		fail("Could not finish the take file");
+	}
+}
+
+static void readBytes(std::istream& in, void* data, size_t size) {
+	if (!in.read(static_cast<char*>(data), size)) {
+		throw std::runtime_error("Take file is truncated");
+	}
+}
+
+size_t readTake(std::istream& in, SampleStore& samples, std::vector<RecordedDevice>& devices, CaptureStats* stats, TakeFileOptions* options) {
+	char magic[4];
+	uint32_t version;
+	double positionStep;
+	uint32_t deviceCount;
+	readBytes(in, magic, sizeof(magic));
+	if (std::memcmp(magic, takeMagic, sizeof(magic)) != 0) {
+		throw std::runtime_error("Not a take file");
+	}
+	readBytes(in, &version, sizeof(version));
+	if (version != takeVersion && version != unflaggedVersion && version != millisecondVersion) {
+		throw std::runtime_error("Unsupported take file version");
+	}
+	int64_t timeScale = version == millisecondVersion ? 1000000 : 1;
+	readBytes(in, &positionStep, sizeof(positionStep));
+	uint32_t flags = 0;
+	if (version == takeVersion) {
+		readBytes(in, &flags, sizeof(flags));
+	}
+	if (options) {
+		options->positionStep = positionStep;
+		options->gated = (flags & gatedFlag) != 0;
+	}
+	readBytes(in, &deviceCount, sizeof(deviceCount));
+	devices.clear();
+	for (uint32_t i = 0; i < deviceCount; i++) {
+		RecordedDevice device;
+		uint16_t length;
+		readBytes(in, &device.id, sizeof(device.id));
+		readBytes(in, &length, sizeof(length));
+		device.name.resize(length);
+		if (length > 0) {
+			readBytes(in, &device.name[0], length);
+		}
+		devices.push_back(device);
+	}
+
+	size_t total = 0;
+	std::vector<uint8_t> payload;
+	uint32_t header[4];
+	while (in.read(reinterpret_cast<char*>(header), sizeof(header))) {
+		payload.resize(header[3]);
+		if (!in.read(reinterpret_cast<char*>(payload.data()), payload.size())) {
+			//a take that was cut off keeps everything up to its last complete chunk
+			break;
+		}
+		if (header[0] == deviceTag && header[1] < vr::k_unMaxTrackedDeviceCount && payload.size() >= sizeof(uint16_t)) {
+			uint16_t length;
+			std::memcpy(&length, payload.data(), sizeof(length));
+			length = (uint16_t)std::min<size_t>(length, payload.size() - sizeof(length));
+			bool known = std::any_of(devices.begin(), devices.end(), [&](const RecordedDevice& device) { return device.id == header[1]; });
+			if (!known) {
+				devices.push_back({ header[1], std::string(reinterpret_cast<const char*>(payload.data()) + sizeof(length), length) });
+			}
+			continue;
+		}
+		if (header[0] == statsTag && stats && payload.size() >= sizeof(stats->rate)) {
+			const uint8_t* p = payload.data() + sizeof(stats->rate);
+			std::memcpy(&stats->rate, payload.data(), sizeof(stats->rate));
+			getHistogram(p, payload.data() + payload.size(), stats->poseReads);
+			stats->devices.clear();
+			for (uint32_t i = 0; i < header[2]; i++) {
+				DeviceCaptureStats device;
+				device.id = (uint32_t)getVarint(p, payload.data() + payload.size());
+				device.samples = (long long)getVarint(p, payload.data() + payload.size());
+				device.invalid = (long long)getVarint(p, payload.data() + payload.size());
+				getHistogram(p, payload.data() + payload.size(), device.intervals);
+				stats->devices.push_back(device);
+			}
+			continue;
+		}
+		if (header[0] == gateTag && stats) {
+			const uint8_t* p = payload.data();
+			for (uint32_t i = 0; i < header[2]; i++) {
+				auto id = (uint32_t)getVarint(p, payload.data() + payload.size());
+				auto gated = (long long)getVarint(p, payload.data() + payload.size());
+				for (auto& device : stats->devices) {
+					if (device.id == id) {
+						device.gated = gated;
+					}
+				}
+			}
+			continue;
+		}
+		//unknown chunks are skipped, so older readers can open newer takes
+		if (header[0] != dataTag || header[1] >= vr::k_unMaxTrackedDeviceCount) {
+			continue;
+		}
+		auto& track = samples[header[1]];
+		const uint8_t* p = payload.data();
+		const uint8_t* end = p + payload.size();
+		int64_t time = 0;
+		int64_t pos[3] = { 0, 0, 0 };
+		int32_t rot[3] = { 0, 0, 0 };
+		int lastLargest = -1;
+		for (uint32_t i = 0; i < header[2]; i++) {
+			uint64_t first = getVarint(p, end);
+			int largest = (int)(first & 3);
+			time += unzigzag(first >> 2);
+			for (int c = 0; c < 3; c++) {
+				pos[c] += unzigzag(getVarint(p, end));
+			}
+			if (largest != lastLargest) {
+				rot[0] = rot[1] = rot[2] = 0;
+				lastLargest = largest;
+			}
+			for (int c = 0; c < 3; c++) {
+				rot[c] += (int32_t)unzigzag(getVarint(p, end));
+			}
+			vr::HmdVector3_t position = { { (float)(pos[0] * positionStep), (float)(pos[1] * positionStep), (float)(pos[2] * positionStep) } };
+			track.push(time * timeScale, position, decodeRotation(largest, rot));
+		}
+		total += header[2];
+	}
+	return total;
+}
+
+size_t readTake(const std::string& filename, SampleStore& samples, std::vector<RecordedDevice>& devices, CaptureStats* stats, TakeFileOptions* options) {
+	std::ifstream in(filename, std::ios::binary);
+	if (!in) {
+		throw std::runtime_error("Could not open take file: " + filename);
+	}
+	return readTake(in, samples, devices, stats, options);
+}
+
+bool isTakeFile(const std::string& filename) {
+	if (filename.size() < 4) {
+		return false;
+	}
+	std::string extension = filename.substr(filename.size() - 4);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return extension == ".vtr";
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CaptureStats.h"
+#include "SampleStore.h"
+
+/*
+Native raw take format (.vtr), lossless up to the chosen position precision.
+
+A header with the quantization step and the recorded devices is followed by chunks.
+Devices that connect during the take are declared by a device chunk before their first samples.
+Every chunk holds up to chunkSamples samples of one device and can be decoded on its own:
+its first sample is stored absolute, all others as zigzag varint deltas of the previous one.
+Times are nanoseconds; takes of version 1 stored milliseconds and are still read. Since version 3 the header
+has flags, which tell whether a motion gate thinned out the take even when it was cut off before its gate chunk.
+A stats chunk written when the take ends holds the capture loop's timing histograms (CaptureStats),
+followed by a gate chunk with the samples per device a motion gate dropped, if it dropped any.
+Positions are quantized to positionStep meters, rotations use smallest-three compression with
+16 bits per component (about 0.003 degrees).
+*/
+struct TakeFileOptions {
+public:
+	double positionStep = 0.00001; // 0.01 mm
+	uint32_t chunkSamples = 4096;
+	// a motion gate thins out the samples, so exports interpolate the keys linearly
+	bool gated = false;
+};
+
+class TakeWriter {
+private:
+	std::unique_ptr<std::ofstream> file;
+	std::ostream* out;
+	TakeFileOptions options;
+	std::vector<std::vector<KeyFrame>> pending;
+	std::vector<uint8_t> buffer;
+	size_t written = 0;
+	bool closed = false;
+	// a write failed, the rest of the take is not written
+	bool failed = false;
+	// one bit per device that is in the header or has a device chunk
+	uint64_t declared = 0;
+
+	void writeHeader(const std::vector<RecordedDevice>& devices);
+	void writeChunk(uint32_t devId, const KeyFrame* frames, size_t count);
+	void writeBytes(const void* data, size_t size);
+	[[noreturn]] void fail(const std::string& message);
+public:
+	TakeWriter(const std::string& filename, const std::vector<RecordedDevice>& devices, const TakeFileOptions& options = TakeFileOptions());
+	TakeWriter(std::ostream& out, const std::vector<RecordedDevice>& devices, const TakeFileOptions& options = TakeFileOptions());
+	~TakeWriter();
+	TakeWriter(const TakeWriter&) = delete;
+	TakeWriter& operator=(const TakeWriter&) = delete;
+
+	// Declares a device that was not in the header, before its first sample. Does nothing for known devices.
+	void addDevice(const RecordedDevice& device);
+	// Writes the timing of the take as a stats chunk, and the gated samples as a gate chunk
+	void writeStats(const CaptureStats& stats);
+	// Buffers a sample, a chunk is encoded and written once a device has chunkSamples of them
+	void append(uint32_t devId, const KeyFrame& frame);
+	// Encodes a whole recorded track
+	void writeTrack(uint32_t devId, const DeviceTrack& track);
+	// Writes what is still buffered. Like every write, throws if the data did not make it into the file.
+	void close();
+
+	size_t bytesWritten() const {
+		return written;
+	}
+};
+
+/*
+Reads a take into samples. Returns the number of samples, throws if the data is not a take.
+stats is filled from the take's stats chunk, if it has one, and options from its header.
+*/
+size_t readTake(std::istream& in, SampleStore& samples, std::vector<RecordedDevice>& devices, CaptureStats* stats = nullptr, TakeFileOptions* options = nullptr);
+size_t readTake(const std::string& filename, SampleStore& samples, std::vector<RecordedDevice>& devices, CaptureStats* stats = nullptr, TakeFileOptions* options = nullptr);
+
+bool isTakeFile(const std::string& filename);
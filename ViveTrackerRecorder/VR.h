@@ -5,6 +5,8 @@
 #include <map>
 #include <openvr.h>
 
+#include "Rotation.h"
+
 struct VrDevice {
 public:
 	int id;
@@ -14,18 +16,21 @@ public:
 
 class VR {
 private:
-	vr::IVRSystem* system;
+	vr::IVRSystem* system = nullptr;
+	bool ownsRuntime = false;
 public:
 	void init();
+	// Uses an already created IVRSystem (e.g. MockVRSystem) instead of starting the SteamVR runtime
+	void attach(vr::IVRSystem* system);
 	void stop();
 	std::map<int, VrDevice> listDevices();
 
+	// Reads the poses of the devices 0..count-1 with a single call into the runtime
+	void readPoses(vr::TrackedDevicePose_t* poses, uint32_t count);
+
 	vr::IVRSystem* getSystem() {
 		return system;
 	}
 
 	static std::string classToText(vr::ETrackedDeviceClass devClass);
-};
-
-vr::HmdQuaternion_t getRotation(vr::HmdMatrix34_t matrix);
-vr::HmdVector3_t getPosition(vr::HmdMatrix34_t matrix);
\ No newline at end of file
+};
\ No newline at end of file